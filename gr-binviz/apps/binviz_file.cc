@@ -0,0 +1,410 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2016 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Offline viewer of a bit dump (e.g. written by a file sink), no flowgraph
+ * needed. The file is mapped, not read: a window of the image size is
+ * framed from an offset on demand, thus a capture of several gigabytes
+ * opens as fast as a small one.
+ *
+ * Usage: binviz-file [options] file
+ *
+ *   -w width          dots per line (default 1024)
+ *   -l lines          lines of the image (default 1024)
+ *   -s pattern        start pattern, e.g. 10101010
+ *   -e pattern        end pattern
+ *   -d pattern        drop pattern
+ *   -z                skip zero bytes
+ *   -f msb|lsb|unpacked
+ *                     format of the file (default msb)
+ *   -o offset         byte offset of the first window (default 0)
+ *   -p image          write the first window to image (PGM) and exit
+ *
+ * Keys: page down / arrow down show the next window, page up / arrow up
+ * the previous one, home and end the first and last window, 0 to 9 jump
+ * to 0% to 90% of the file, Q quits.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "binimg.h"
+#include "bitqueue.h"
+#include "framer.h"
+#include "mappedfile.h"
+
+/**
+ * @brief The Options struct holds the command line
+ */
+struct Options
+{
+    int width;
+    int height;
+    std::string start_pattern;
+    std::string end_pattern;
+    std::string drop_pattern;
+    bool skip_zero_bytes;
+    BitPacker::Format format;
+    size_t offset;
+    std::string image_file;
+    std::string file;
+};
+
+/**
+ * @brief The Viewer class frames windows of a mapped file into a BinImg.
+ * Each window is framed by a Framer of its own from a byte offset on, the
+ * lines are placed by BinImg::putLine() until the image is full.
+ */
+class Viewer
+{
+    private:
+        const Options &options;
+        const MappedFile &file;
+        BinImg &img;
+
+        // bytes framed at a time
+        size_t chunk;
+
+        // offsets of the windows shown, the last one is on display
+        std::vector<size_t> history;
+
+        size_t next;
+
+        size_t fill(size_t offset);
+
+    public:
+        Viewer(const Options &options, const MappedFile &file, BinImg &img);
+
+        size_t windowBytes() const;
+
+        void show(size_t offset);
+        void forward();
+        void back();
+};
+
+/**
+ * @brief Viewer::Viewer
+ * @param options of the command line
+ * @param file mapped
+ * @param img the windows are shown on
+ */
+Viewer::Viewer(const Options &options, const MappedFile &file, BinImg &img)
+    :options(options), file(file), img(img), next(0)
+{
+    // about a line at a time, the windows overlap by up to a chunk
+    chunk = std::max(8, options.width / 8);
+
+    if (options.format == BitPacker::UNPACKED) {
+        chunk *= 8;
+    }
+}
+
+/**
+ * @brief Viewer::windowBytes
+ * @return the number of bytes a window shows without any line framed
+ * short (e.g. the distance of the last window to the end of the file)
+ */
+size_t
+Viewer::windowBytes() const
+{
+    size_t nr_dots = (size_t) options.width * options.height;
+
+    return options.format == BitPacker::UNPACKED ? nr_dots : nr_dots / 8;
+}
+
+/**
+ * @brief Viewer::fill clears the image and frames the file from offset on
+ * until the image is full or the file ends
+ * @param offset of the first byte framed
+ * @return the offset of the chunk the image was filled by (the next window
+ * starts there), the size of the file if it ended first
+ */
+size_t
+Viewer::fill(size_t offset)
+{
+    const unsigned char *data = file.data();
+    size_t size = file.size();
+
+    img.clear();
+
+    // start on the first start pattern rather than in the middle of a line
+    if (!options.start_pattern.empty() && options.format == BitPacker::PACKED_MSB) {
+        uint64_t nr_bits = std::min(size, offset + 2 * windowBytes()) * 8;
+        int64_t pos = img.detectStart(data, nr_bits, (uint64_t) offset * 8);
+
+        if (pos >= 0) {
+            offset = pos / 8;
+        }
+    }
+
+    Framer framer(options.start_pattern, options.end_pattern, options.drop_pattern, options.skip_zero_bytes, false, 0, 0, false, false, options.format);
+    BitQueue line;
+
+    // dots left in the image, the last line ends in front of the dummy
+    // pixel
+    size_t room = (size_t) options.width * options.height - 1;
+
+    for (size_t i=offset; i < size; i += chunk) {
+        size_t len = std::min(chunk, size - i);
+
+        framer.consume(data + i, len);
+
+        if (i + len == size) {
+            framer.flush();
+        }
+
+        const BitQueue &bits = framer.bits();
+        const std::vector<FrameEvent> &events = framer.getEvents();
+        size_t done = 0;
+
+        for (size_t j=0; j <= events.size(); j++) {
+            size_t pos = j < events.size() ? events[j].pos : bits.size();
+
+            for (; done < pos; done += 64) {
+                line.push_bits(bits.word(done), std::min((size_t) 64, pos - done));
+            }
+
+            done = pos;
+
+            // the image is full, show the part of the line that fits
+            if (line.size() >= room) {
+                line.pop_back(line.size() - room);
+                img.putLine(line);
+                framer.clear();
+
+                return i;
+            }
+
+            if (j == events.size() || events[j].type != FrameEvent::WRAP) {
+                continue;
+            }
+
+            // a line takes its rows, an empty line a row
+            size_t nr_rows = line.empty() ? 1 : (line.size() - 1) / options.width + 1;
+
+            img.putLine(line);
+            line.clear();
+
+            if (nr_rows * options.width >= room) {
+                framer.clear();
+
+                return i;
+            }
+
+            room -= nr_rows * options.width;
+        }
+
+        framer.clear();
+    }
+
+    // the rest of the file is shorter than a line
+    if (!line.empty()) {
+        img.putLine(line);
+    }
+
+    return size;
+}
+
+/**
+ * @brief Viewer::show the window starting at offset
+ * @param offset of the first byte shown (the start pattern behind if any)
+ */
+void
+Viewer::show(size_t offset)
+{
+    offset = std::min(offset, file.size() - 1);
+
+    next = fill(offset);
+
+    // progress even if a single chunk fills the image
+    if (next <= offset) {
+        next = std::min(offset + chunk, file.size());
+    }
+
+    history.push_back(offset);
+
+    printf("binviz-file: bytes %zu to %zu of %zu\n", offset, next, file.size());
+    fflush(stdout);
+}
+
+/**
+ * @brief Viewer::forward shows the window behind the one on display
+ */
+void
+Viewer::forward()
+{
+    if (next < file.size()) {
+        show(next);
+    }
+}
+
+/**
+ * @brief Viewer::back shows the window shown before the one on display,
+ * the bytes in front of the first window shown
+ */
+void
+Viewer::back()
+{
+    if (history.size() > 1) {
+        history.pop_back();
+
+        size_t offset = history.back();
+
+        history.pop_back();
+        show(offset);
+    }
+    else if (!history.empty() && history.back() > 0) {
+        size_t offset = history.back();
+
+        history.pop_back();
+        show(offset - std::min(offset, windowBytes()));
+    }
+}
+
+/**
+ * @brief usage writes the command line options to stderr
+ * @param name of the program
+ * @return the exit code
+ */
+static int
+usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-w width] [-l lines] [-s start] [-e end] [-d drop] [-z] [-f msb|lsb|unpacked] [-o offset] [-p image] file\n", name);
+
+    return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+    Options options;
+    options.width = 1024;
+    options.height = 1024;
+    options.skip_zero_bytes = false;
+    options.format = BitPacker::PACKED_MSB;
+    options.offset = 0;
+
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:l:s:e:d:zf:o:p:")) != -1) {
+        std::string arg = optarg ? optarg : "";
+
+        switch (opt) {
+            case 'w': options.width = atoi(optarg); break;
+            case 'l': options.height = atoi(optarg); break;
+            case 's': options.start_pattern = arg; break;
+            case 'e': options.end_pattern = arg; break;
+            case 'd': options.drop_pattern = arg; break;
+            case 'z': options.skip_zero_bytes = true; break;
+            case 'o': options.offset = strtoull(optarg, NULL, 0); break;
+            case 'p': options.image_file = arg; break;
+            case 'f':
+                if (arg == "msb") {
+                    options.format = BitPacker::PACKED_MSB;
+                }
+                else if (arg == "lsb") {
+                    options.format = BitPacker::PACKED_LSB;
+                }
+                else if (arg == "unpacked") {
+                    options.format = BitPacker::UNPACKED;
+                }
+                else {
+                    return usage(argv[0]);
+                }
+                break;
+            default:
+                return usage(argv[0]);
+        }
+    }
+
+    if (optind != argc - 1 || options.width < 2 || options.height < 1) {
+        return usage(argv[0]);
+    }
+
+    options.file = argv[optind];
+
+    MappedFile file;
+
+    if (!file.open(options.file)) {
+        fprintf(stderr, "BinViz: opening %s failed (missing or empty)\n", options.file.c_str());
+
+        return 1;
+    }
+
+    bool headless = !options.image_file.empty();
+
+    BinImg::Options img_options;
+    img_options.start_pattern = options.start_pattern;
+    img_options.end_pattern = options.end_pattern;
+    img_options.drop_pattern = options.drop_pattern;
+    img_options.skip_zero_bytes = options.skip_zero_bytes;
+    img_options.headless = headless;
+    img_options.input_format = options.format;
+
+    BinImg img(options.width, options.height, img_options);
+    Viewer viewer(options, file, img);
+
+    viewer.show(options.offset);
+
+    if (headless) {
+        return img.save(options.image_file) ? 0 : 1;
+    }
+
+    static const unsigned int DIGITS[] = {
+        cimg_library::cimg::key0, cimg_library::cimg::key1, cimg_library::cimg::key2,
+        cimg_library::cimg::key3, cimg_library::cimg::key4, cimg_library::cimg::key5,
+        cimg_library::cimg::key6, cimg_library::cimg::key7, cimg_library::cimg::key8,
+        cimg_library::cimg::key9
+    };
+
+    while (!img.closed()) {
+        img.wait();
+
+        unsigned int key = img.key();
+
+        if (key == cimg_library::cimg::keyPAGEDOWN || key == cimg_library::cimg::keyARROWDOWN) {
+            viewer.forward();
+        }
+        else if (key == cimg_library::cimg::keyPAGEUP || key == cimg_library::cimg::keyARROWUP) {
+            viewer.back();
+        }
+        else if (key == cimg_library::cimg::keyHOME) {
+            viewer.show(0);
+        }
+        else if (key == cimg_library::cimg::keyEND) {
+            viewer.show(file.size() - std::min(file.size(), viewer.windowBytes()));
+        }
+        else if (key == cimg_library::cimg::keyQ) {
+            break;
+        }
+
+        for (int i=0; i < 10; i++) {
+            if (key == DIGITS[i]) {
+                viewer.show(file.size() / 10 * i);
+            }
+        }
+    }
+
+    return 0;
+}
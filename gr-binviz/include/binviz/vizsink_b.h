@@ -23,6 +23,8 @@
 #define INCLUDED_BINVIZ_VIZSINK_S_H
 
 #include <string>
+#include <vector>
+#include <stdint.h>
 #include <binviz/api.h>
 #include <gnuradio/sync_block.h>
 
@@ -40,7 +42,9 @@ namespace gr {
      * of bit streams.
      *
      * Feed the GUI with a decoded stream of 0s and 1s and it will display
-     * the relevant bits as white (on) and black (off). Use /p width and
+     * the relevant bits as white (on) and black (off). Bits are read
+     * packed (8 per byte) or unpacked (1 per byte) as set by
+     * /p input_format. Use /p width and
      * /p height to set the dimension of your display. In any case the
      * stream will continue at the upper left corner if it hits the bottom
      * edge.
@@ -58,6 +62,18 @@ namespace gr {
      * occurences of the /p start_pattern will be meanless until the
      * /p end_pattern ist detected.
      *
+     * Protocols with several sync words (e.g. a preamble per packet type)
+     * take a comma separated list of start patterns. Lines are shaded by
+     * the start pattern they start with.
+     *
+     * On noisy links a single bit error in a preamble would shift a whole
+     * line. Set /p start_errors and /p end_errors to tolerate a number of
+     * bit errors (Hamming distance) in start and end pattern matches.
+     *
+     * Streams already tagged by an upstream correlator are framed by
+     * their tags. Set /p start_tag_key and/or /p end_tag_key to start and
+     * end lines at the tags with these keys, no pattern is searched then.
+     *
      * To get rid of long sequences of zero bytes or arbitrary unwanted
      * bit sequences set the /p skip_zero_bytes to true or define a string
      * of 0s and 1s for /p drop_pattern to be removed. Note, the params
@@ -74,9 +90,45 @@ namespace gr {
      * further bits. During inspection bits are not dropped but held and
      * being painted once ESC is hit.
      *
+     * Painting new bits and refreshing the display are decoupled. The
+     * block only draws into an image, a separate render thread pushes
+     * that image to the display at /p frame_rate refreshes per second.
+     * Set /p handoff_size to hand the bits over to the render thread by
+     * a lock-free ring, then the block never waits for the render thread
+     * to release the image (unless the ring is full and /p overflow is set
+     * to block).
+     *
+     * Set /p headless to run without any display, e.g. on servers or in
+     * batch flowgraphs. The image is then written to /p dump_file instead.
+     *
+     * Captures can be kept for later review. Each time the stream wraps
+     * from the bottom to the top of the image (and every
+     * /p export_interval seconds if set) the image is written to numbered
+     * /p snapshot_file snapshots and/or appended to the raw
+     * /p stream_file. Files are written by a background thread, slow
+     * disks never hold up the flowgraph.
+     *
+     * Lines scrolled off the display are lost unless /p scrollback_file
+     * is set. All lines are then recorded to that file and the display
+     * can be scrolled back through them (page up/down, arrow up/down,
+     * home and end).
+     *
+     * Framed packets (start and end pattern defined) are indexed in
+     * /p index_file. Any packet can then be read back from the
+     * scrollback or shown on the display without replaying the capture.
+     *
+     * Set /p column_stats to count the ones per column over all lines.
+     * With start and end pattern defined every line is a packet, thus
+     * constant fields, counters and checksums stand out in a heatmap of
+     * the frequency of ones and the entropy per column.
+     *
+     * Captures of a beacon repeated thousands of times fill the display
+     * with identical lines. Set /p dedup to display each packet once, its
+     * repeats are counted in a gutter right of the line.
+     *
      * Hint: Binviz runs as thread. Thus, closing the Binviz window will
      * not stop GRC but stopping GRC will close the Binviz window. Take
-     * your screenshots before.
+     * your screenshots before or use /p snapshot_file.
      */
     class BINVIZ_API vizsink_b : virtual public gr::sync_block
     {
@@ -94,7 +146,10 @@ namespace gr {
        * any occurence of the start sequence. Note, that in case the start
        * and the end pattern are defined, additional occurences of the
        * start pattern right after the start pattern but before an end
-       * pattern will be ignored.
+       * pattern will be ignored. Several start patterns are separated by
+       * commas, e.g. 10101010,11001100. Lines starting with the second,
+       * third and fourth start pattern are shown in darker shades of
+       * white, the packet index records the start pattern of each packet.
        * \param end_pattern A string of 0s and 1s used to detect the end
        * of a bit sequence. The display will wrap to a new line after any
        * occurence of the end sequence.
@@ -104,9 +159,113 @@ namespace gr {
        * \param skip_zero_bytes If set to true will cause that any byte
        * compsed of zero's will be ignored. Ignorance of zero bytes will
        * have precedence over start, end and drop detections.
+       * \param frame_rate The number of display refreshes per second.
+       * Bits are drawn into the image as they arrive, the display itself
+       * is updated by a separate render thread at this rate.
+       * \param headless If set to true no display is opened and no X
+       * server is required. The image is only maintained in memory and
+       * written to /p dump_file at /p frame_rate whenever it changed.
+       * \param dump_file Path of the PGM file the image is written to in
+       * headless mode. Leave empty to not write anything.
+       * \param snapshot_file Exported images are written to numbered
+       * files named after this one, e.g. capture.png becomes
+       * capture_000000.png, capture_000001.png, ... Written as PNG if
+       * the name ends with .png, as PGM otherwise. Leave empty to not
+       * write snapshots.
+       * \param stream_file Exported images are appended to this file or
+       * FIFO as raw frames of 1 bit per pixel (1 is on), most significant
+       * bit first, each row padded to a full byte. Leave empty to not
+       * write a stream.
+       * \param export_interval Images are exported on each wrap from the
+       * bottom to the top of the image. If greater than zero they are
+       * additionally exported every export_interval seconds as long as
+       * the image changed.
+       * \param scrollback_file Every displayed line is recorded to this
+       * file (1 bit per dot), also the ones scrolled off the display.
+       * Use page up/down, arrow up/down and home on the display to scroll
+       * back through the recorded lines, end returns to the live image.
+       * Leave empty to not record lines.
+       * \param index_file If both, the start and the end pattern, are
+       * defined the offset in the stream, the length, the time of
+       * detection and the /p scrollback_file line of every packet are
+       * recorded to this file. Leave empty to not index packets.
+       * \param column_stats If set to true the ones per column of all
+       * lines are counted. A second window shows the frequency of ones
+       * (top) and the entropy (bottom) per column as heatmap, white is
+       * all ones or 1 bit of entropy.
+       * \param dedup If set to true and both, the start and the end
+       * pattern, are defined, each packet is hashed. Packets already shown
+       * on the display are not displayed (nor recorded or indexed) again,
+       * the number of repeats is shown in binary in a gutter right of the
+       * line instead. Once its line is overwritten a packet is displayed
+       * again.
+       * \param start_errors The number of bit errors tolerated in a match
+       * of the start pattern, less than half the pattern length. 0 only
+       * detects exact matches.
+       * \param end_errors The number of bit errors tolerated in a match
+       * of the end pattern, less than half the pattern length. 0 only
+       * detects exact matches.
+       * \param start_tag_key If set, stream tags with this key (e.g.
+       * attached by correlate_access_code_tag_bb) start a new line at the
+       * item (byte, bit if unpacked) they are attached to instead of the
+       * start pattern. Lines are framed by tags only then, start and end
+       * patterns are not searched.
+       * \param end_tag_key If set, stream tags with this key end a line
+       * in front of the item they are attached to instead of the end
+       * pattern. With both tag keys set lines run from a start tag to the
+       * next end tag like packets.
+       * \param input_format 0: bytes packed most significant bit first,
+       * 1: bytes packed least significant bit first, 2: unpacked bits,
+       * one bit per byte in its lowest bit (e.g. the output of a
+       * demodulator, no pack_k_bits block needed).
+       * \param handoff_size If greater than zero, framed bits are handed
+       * over to the render thread by a lock-free ring of (at least) this
+       * many bits, it should hold the bits of a frame period. 0 draws the
+       * bits right away, the block holds the image lock meanwhile.
+       * \param overflow What the block does once the hand-off ring is
+       * full. 0: draw the bits in the ring right away as without ring (no
+       * bits lost), 1: drop the oldest bits, 2: drop every other line
+       * while the ring is more than half full and the newest bits once it
+       * is full.
        * \return The number of bytes consumed.
        */
-      static sptr make(int width, int height, const std::string &start_pattern = "", const std::string &end_pattern = "", const std::string &drop_pattern = "", bool skip_zero_bytes = false);
+      static sptr make(int width, int height, const std::string &start_pattern = "", const std::string &end_pattern = "", const std::string &drop_pattern = "", bool skip_zero_bytes = false, double frame_rate = 30, bool headless = false, const std::string &dump_file = "", const std::string &snapshot_file = "", const std::string &stream_file = "", double export_interval = 0, const std::string &scrollback_file = "", const std::string &index_file = "", bool column_stats = false, bool dedup = false, int start_errors = 0, int end_errors = 0, const std::string &start_tag_key = "", const std::string &end_tag_key = "", int input_format = 0, int handoff_size = 0, int overflow = 0);
+
+      /*!
+       * \brief nr_packets
+       * \return The number of packets indexed so far.
+       */
+      virtual uint64_t nr_packets() = 0;
+
+      /*!
+       * \brief packet Reads a packet back from the scrollback, requires
+       * /p index_file and /p scrollback_file.
+       * \param nr The number of the packet (0 is the first packet).
+       * \return The bits of the packet, one byte (0 or 1) per bit, empty
+       * if there is no such packet.
+       */
+      virtual std::vector<unsigned char> packet(uint64_t nr) = 0;
+
+      /*!
+       * \brief show_packet Scrolls the display back to a packet,
+       * requires /p index_file and /p scrollback_file.
+       * \param nr The number of the packet (0 is the first packet).
+       */
+      virtual void show_packet(uint64_t nr) = 0;
+
+      /*!
+       * \brief column_frequency requires /p column_stats.
+       * \return The share of ones per column (0 to 1), empty without
+       * column statistics.
+       */
+      virtual std::vector<float> column_frequency() = 0;
+
+      /*!
+       * \brief column_entropy requires /p column_stats.
+       * \return The binary entropy per column (0 to 1 bit), empty without
+       * column statistics.
+       */
+      virtual std::vector<float> column_entropy() = 0;
     };
 
   } // namespace binviz
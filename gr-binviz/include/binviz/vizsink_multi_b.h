@@ -0,0 +1,82 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2016 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INCLUDED_BINVIZ_VIZSINK_MULTI_B_H
+#define INCLUDED_BINVIZ_VIZSINK_MULTI_B_H
+
+#include <string>
+#include <binviz/api.h>
+#include <gnuradio/sync_block.h>
+
+namespace gr {
+  namespace binviz {
+
+    /*!
+     * \brief Provides a GUI that visualizes and compares several bit
+     * streams
+     * \ingroup binviz
+     *
+     * \details
+     * Like vizsink_b, but fed with /p num_inputs streams of 0s and 1s.
+     * Each stream is framed on its own according to /p start_pattern,
+     * /p end_pattern and /p drop_pattern, then line k of every stream is
+     * displayed next to line k of the other streams. Thus, captures of the
+     * same transmitter (e.g. several receivers or repeated recordings) can
+     * be compared line by line even though their packets arrive at
+     * different offsets.
+     *
+     * In the interleaved /p view line k of each stream is displayed on
+     * consecutive rows (stream 0, stream 1, ... then line k+1). In the
+     * diff /p view a single row is displayed per line k, dots are on where
+     * any stream differs from stream 0.
+     *
+     * Lines are displayed once all streams have them. A stream that lags
+     * behind more than /p height lines is displayed as empty lines.
+     */
+    class BINVIZ_API vizsink_multi_b : virtual public gr::sync_block
+    {
+     public:
+      typedef boost::shared_ptr<vizsink_multi_b> sptr;
+
+      /*!
+       * \brief make Creates the Binviz display for several streams
+       * \param num_inputs The number of streams to be compared
+       * \param width The width of the display, see vizsink_b
+       * \param height The height of the display
+       * \param start_pattern See vizsink_b, applies to every stream
+       * \param end_pattern See vizsink_b, applies to every stream
+       * \param drop_pattern See vizsink_b, applies to every stream
+       * \param skip_zero_bytes See vizsink_b, applies to every stream
+       * \param view 0 to interleave the lines of all streams, 1 to display
+       * where the streams differ from stream 0
+       * \param nr_threads The number of threads framing the streams, 1
+       * frames all streams on the flowgraph thread
+       * \param frame_rate The number of display refreshes per second
+       * \param headless If set to true no display is opened and no X
+       * server is required
+       */
+      static sptr make(int num_inputs, int width, int height, const std::string &start_pattern = "", const std::string &end_pattern = "", const std::string &drop_pattern = "", bool skip_zero_bytes = false, int view = 0, int nr_threads = 1, double frame_rate = 30, bool headless = false);
+    };
+
+  } // namespace binviz
+} // namespace gr
+
+#endif /* INCLUDED_BINVIZ_VIZSINK_MULTI_B_H */
@@ -0,0 +1,359 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2016 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Headless throughput benchmark of the framing and display path. Synthetic
+ * streams are fed to the Framer, the BinImg (with and without hand-off
+ * ring) and the vizsink_b block's work() in windows of WINDOW bytes, and
+ * to the BinImg a byte per call as work() used to do (consume_per_byte).
+ * One measurement per line is written to stdout as CSV:
+ *
+ *   workload,stage,metric,value
+ *
+ * Usage: bench-binviz [megabytes per workload, default 8]
+ */
+
+#include <binviz/vizsink_b.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "binimg.h"
+#include "bitqueue.h"
+#include "framer.h"
+
+// bytes per call, the size of a typical flowgraph buffer
+static const size_t WINDOW = 8192;
+
+static const int WIDTH = 1024;
+static const int HEIGHT = 1024;
+static const double FRAME_RATE = 30;
+
+/**
+ * @brief The Workload struct is a synthetic stream and the patterns it is
+ * framed with
+ */
+struct Workload
+{
+    std::string name;
+    std::string start_pattern;
+    std::string end_pattern;
+    std::string drop_pattern;
+    bool skip_zero_bytes;
+    std::vector<unsigned char> bytes;
+};
+
+/**
+ * @brief now
+ * @return seconds since the epoch
+ */
+static double
+now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * @brief report writes a measurement as CSV line
+ */
+static void
+report(const Workload &workload, const char *stage, const char *metric, double value)
+{
+    printf("%s,%s,%s,%.6g\n", workload.name.c_str(), stage, metric, value);
+    fflush(stdout);
+}
+
+/**
+ * @brief reportRate writes the throughput of a stage
+ * @param seconds it took to process all bytes of the workload
+ */
+static void
+reportRate(const Workload &workload, const char *stage, double seconds)
+{
+    double nr_bits = 8.0 * workload.bytes.size();
+
+    report(workload, stage, "bytes_per_s", workload.bytes.size() / seconds);
+    report(workload, stage, "ns_per_bit", 1e9 * seconds / nr_bits);
+}
+
+/**
+ * @brief pushPattern appends a pattern of '0' and '1' to a bit queue
+ */
+static void
+pushPattern(BitQueue &bits, const std::string &pattern)
+{
+    for (size_t i=0; i < pattern.size(); i++) {
+        bits.push_back(pattern[i] == '1');
+    }
+}
+
+/**
+ * @brief pushRandom appends random bits to a bit queue
+ */
+static void
+pushRandom(BitQueue &bits, size_t nr_bits)
+{
+    for (; nr_bits >= 16; nr_bits -= 16) {
+        bits.push_bits((uint64_t) (rand() & 0xffff) << 48, 16);
+    }
+
+    for (; nr_bits > 0; nr_bits--) {
+        bits.push_back(rand() & 1);
+    }
+}
+
+/**
+ * @brief toBytes packs a bit queue into bytes, most significant bit first
+ * (the last byte is padded with zeros)
+ */
+static void
+toBytes(const BitQueue &bits, std::vector<unsigned char> &bytes)
+{
+    bytes.resize((bits.size() + 7) / 8);
+
+    for (size_t i=0; i < bits.size(); i += 64) {
+        uint64_t word = bits.word(i);
+
+        for (size_t j=0; j < 8 && i / 8 + j < bytes.size(); j++) {
+            bytes[i / 8 + j] = word >> (56 - 8 * j);
+        }
+    }
+}
+
+/**
+ * @brief makeWorkloads generates the synthetic streams
+ * @param nr_bytes approximate size of each stream
+ */
+static std::vector<Workload>
+makeWorkloads(size_t nr_bytes)
+{
+    std::vector<Workload> workloads;
+    Workload workload;
+
+    // random bits, nothing to frame (bulk path)
+    workload.name = "random";
+    workload.skip_zero_bytes = false;
+    workload.bytes.resize(nr_bytes);
+
+    for (size_t i=0; i < nr_bytes; i++) {
+        workload.bytes[i] = rand();
+    }
+
+    workloads.push_back(workload);
+
+    // packets of 256 random bits between a preamble and an end flag,
+    // separated by idle bits
+    BitQueue bits;
+
+    workload.name = "preamble";
+    workload.start_pattern = "1010101011001100";
+    workload.end_pattern = "0111111001111110";
+
+    while (bits.size() < 8 * nr_bytes) {
+        pushRandom(bits, rand() % 64);
+        pushPattern(bits, workload.start_pattern);
+        pushRandom(bits, 256);
+        pushPattern(bits, workload.end_pattern);
+    }
+
+    toBytes(bits, workload.bytes);
+    workloads.push_back(workload);
+
+    // random bits, the drop pattern occurs every 16 bits on average
+    workload.name = "drop";
+    workload.start_pattern = "";
+    workload.end_pattern = "";
+    workload.drop_pattern = "1101";
+    workload.bytes = workloads[0].bytes;
+    workloads.push_back(workload);
+
+    // short bursts between long runs of zero bytes
+    workload.name = "zeros";
+    workload.start_pattern = "10101010";
+    workload.drop_pattern = "";
+    workload.skip_zero_bytes = true;
+    workload.bytes.clear();
+
+    while (workload.bytes.size() < nr_bytes) {
+        workload.bytes.resize(workload.bytes.size() + 64 + rand() % 4096, 0);
+
+        for (int i=16 + rand() % 240; i > 0; i--) {
+            workload.bytes.push_back(rand() | 1);
+        }
+    }
+
+    workloads.push_back(workload);
+
+    return workloads;
+}
+
+/**
+ * @brief benchFramer frames a workload without display, once with and
+ * once without its start and end patterns (the difference is the cost of
+ * pattern matching)
+ */
+static void
+benchFramer(const Workload &workload)
+{
+    for (int patterns=0; patterns < 2; patterns++) {
+        Framer framer(patterns ? workload.start_pattern : "", patterns ? workload.end_pattern : "", workload.drop_pattern, workload.skip_zero_bytes);
+        double start = now();
+
+        for (size_t i=0; i < workload.bytes.size(); i += WINDOW) {
+            framer.consume(&workload.bytes[i], std::min(WINDOW, workload.bytes.size() - i));
+            framer.clear();
+        }
+
+        framer.flush();
+        framer.clear();
+
+        reportRate(workload, patterns ? "framer" : "framer_plain", now() - start);
+    }
+
+    if (workload.start_pattern.empty()) {
+        return;
+    }
+
+    // start pattern search over the whole stream at all bit phases
+    Framer framer(workload.start_pattern);
+    uint64_t nr_bits = 8 * (uint64_t) workload.bytes.size();
+    uint64_t nr_matches = 0;
+    double start = now();
+
+    for (int64_t pos = framer.detectStart(&workload.bytes[0], nr_bits, 0); pos >= 0; pos = framer.detectStart(&workload.bytes[0], nr_bits, pos + 1)) {
+        nr_matches++;
+    }
+
+    reportRate(workload, "search", now() - start);
+    report(workload, "search", "matches", nr_matches);
+}
+
+/**
+ * @brief benchImg feeds a workload to a headless image writing a dump
+ * file at FRAME_RATE and reports the frame times of its render thread
+ * @param handoff_bits size of the hand-off ring, 0 to place bits right away
+ * @param per_byte feed one byte per consume() call (as work() used to do)
+ * instead of WINDOW bytes
+ */
+static void
+benchImg(const Workload &workload, size_t handoff_bits, bool per_byte = false)
+{
+    const char *stage = per_byte ? "consume_per_byte" : handoff_bits ? "consume_handoff" : "consume";
+    char dump_file[64];
+    snprintf(dump_file, sizeof(dump_file), "/tmp/bench_binviz_%d.pgm", (int) getpid());
+
+    BinImg::Options options;
+    options.start_pattern = workload.start_pattern;
+    options.end_pattern = workload.end_pattern;
+    options.drop_pattern = workload.drop_pattern;
+    options.skip_zero_bytes = workload.skip_zero_bytes;
+    options.frame_rate = FRAME_RATE;
+    options.headless = true;
+    options.dump_file = dump_file;
+    options.handoff_bits = handoff_bits;
+
+    uint64_t nr_frames;
+    double mean;
+    double max;
+
+    {
+        BinImg img(WIDTH, HEIGHT, options);
+        double start = now();
+
+        if (per_byte) {
+            for (size_t i=0; i < workload.bytes.size(); i++) {
+                img.consume(workload.bytes[i]);
+            }
+        }
+        else {
+            for (size_t i=0; i < workload.bytes.size(); i += WINDOW) {
+                img.consume(&workload.bytes[i], std::min(WINDOW, workload.bytes.size() - i));
+            }
+        }
+
+        img.flush();
+        reportRate(workload, stage, now() - start);
+
+        img.fetchFrameTimes(nr_frames, mean, max);
+    }
+
+    report(workload, stage, "frames", nr_frames);
+    report(workload, stage, "frame_ms_mean", 1e3 * mean);
+    report(workload, stage, "frame_ms_max", 1e3 * max);
+
+    unlink(dump_file);
+}
+
+/**
+ * @brief benchWork feeds a workload to the work() of a headless sink block
+ * as the scheduler would
+ */
+static void
+benchWork(const Workload &workload)
+{
+    gr::binviz::vizsink_b::sptr sink = gr::binviz::vizsink_b::make(WIDTH, HEIGHT, workload.start_pattern, workload.end_pattern, workload.drop_pattern, workload.skip_zero_bytes, FRAME_RATE, true);
+    gr_vector_const_void_star input_items(1);
+    gr_vector_void_star output_items;
+    double start = now();
+
+    for (size_t i=0; i < workload.bytes.size(); i += WINDOW) {
+        input_items[0] = &workload.bytes[i];
+        sink->work(std::min(WINDOW, workload.bytes.size() - i), input_items, output_items);
+    }
+
+    reportRate(workload, "work", now() - start);
+}
+
+int
+main(int argc, char **argv)
+{
+    double megabytes = argc > 1 ? atof(argv[1]) : 8;
+
+    if (megabytes <= 0) {
+        fprintf(stderr, "usage: %s [megabytes per workload]\n", argv[0]);
+
+        return 1;
+    }
+
+    srand(20);
+
+    std::vector<Workload> workloads = makeWorkloads((size_t) (megabytes * 1024 * 1024));
+
+    printf("workload,stage,metric,value\n");
+
+    for (size_t i=0; i < workloads.size(); i++) {
+        benchFramer(workloads[i]);
+        benchImg(workloads[i], 0, true);
+        benchImg(workloads[i], 0);
+
+        // the ring holds the bits of a frame period at 100 Mbit/s
+        benchImg(workloads[i], (size_t) (100e6 / FRAME_RATE));
+        benchWork(workloads[i]);
+    }
+
+    return 0;
+}
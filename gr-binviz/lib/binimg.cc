@@ -2,234 +2,834 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <sys/time.h>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 // Define ON and OFF as black and white. Syntax follows CImg colors
 const unsigned char BinImg::ON[] = {255};
 const unsigned char BinImg::OFF[] = {0};
 const unsigned char BinImg::CLEAR[] = {128};
+const unsigned char BinImg::TAGGED[][1] = {{255}, {208}, {176}, {152}};
+const int BinImg::NR_TAGGED = 4;
 const bool BinImg::REDRAW = true;
 const char BinImg::TITLE[] = "BinViz, click or wheel";
+const double BinImg::DEFAULT_FRAME_RATE = 30;
+const char BinImg::STATS_TITLE[] = "BinViz statistics, %llu lines";
+const int BinImg::STATS_HEIGHT = 8;
+const int BinImg::GUTTER = 17;
+
+/**
+ * @brief BinImg::Options::Options sets the defaults: a plain display at the
+ * default frame rate, no patterns, no export or recording
+ */
+BinImg::Options::Options()
+    :skip_zero_bytes(false), frame_rate(DEFAULT_FRAME_RATE), headless(false), export_interval(0), column_stats(false), dedup(false), start_errors(0), end_errors(0), start_marks(false), end_marks(false), input_format(BitPacker::PACKED_MSB), handoff_bits(0), overflow(HandoffRing::BLOCK)
+{
+}
 
 /**
  * @brief BinImg::BinImg create a simple image (black/white)
  * @param width the width of the image
  * @param height the height of the image
- * @param start_pattern marks start of a packet and puts new line before the pattern (e.g. '101010')
- * @param end_pattern marks end of packet and wraps to new line
- * @param drop_pattern will kill all occurences of the pattern recoursively but will not apply if both, start and stop patterns are defined. The drop pattern have precedence over start and stop patterns.
+ * @param options patterns, display, export and recording settings (see
+ * BinImg::Options)
  */
-BinImg::BinImg(int width, int height, const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern)
-    :CImg<unsigned char>(width, height, 1, 1), start(start_pattern), end(end_pattern), drop(drop_pattern)
+BinImg::BinImg(int width, int height, const Options &options)
+    :raster(width, height), line(width), frame_rate(options.frame_rate), nr_frames(0), frame_time(0), max_frame_time(0), dirty_top(0), dirty_bottom(height), upload(false), headless(options.headless), dirty(false), dump_file(options.dump_file), export_interval(options.export_interval), export_dirty(false), in_history(false), history_top(0), packet(), packet_open(false), stats_dirty(false), stats_upload(false), gutter(0), packet_row(0), packet_hash(0), skipping(false), framer(options.start_pattern, options.end_pattern, options.drop_pattern, options.skip_zero_bytes, options.dedup, options.start_errors, options.end_errors, options.start_marks, options.end_marks, options.input_format)
 {
-    // queue is empty
-    queue = std::deque<bool>();
+    // failover to default frame rate on nonsense values
+    if (frame_rate <= 0) {
+        frame_rate = DEFAULT_FRAME_RATE;
+    }
+
+    // disk I/O of exported frames happens on a thread of its own
+    if (!options.snapshot_file.empty() || !options.stream_file.empty()) {
+        exporter.reset(new FrameExporter(options.snapshot_file, options.stream_file));
+    }
 
-    // check start and end detection, failover to off on error
-    in_packet = false;
+    // lines are kept on disk once the cursor leaves them, failover to
+    // off if the file can not be created
+    if (!options.scrollback_file.empty()) {
+        scrollback.reset(new Scrollback(options.scrollback_file, width));
 
-    if (!checkPattern(start)) {
-        start = "";
+        if (!scrollback->isOpen()) {
+            scrollback.reset();
+        }
     }
 
-    if (!checkPattern(end)) {
-        end = "";
+    // packets are only framed if both, start and end, are defined
+    if (!options.index_file.empty() && framer.framesPackets()) {
+        packet_index.reset(new PacketIndex(options.index_file));
+
+        if (!packet_index->isOpen()) {
+            packet_index.reset();
+        }
+    }
+
+    if (options.column_stats) {
+        column_stats.reset(new ColumnStats(width));
+    }
+
+    // repeats are told apart by packets only
+    if (options.dedup && framer.framesPackets()) {
+        gutter = GUTTER;
+        row_hash.assign(height, 0);
+        row_repeats.assign(height, 0);
     }
 
-    if (!checkPattern(drop)) {
-        drop = "";
+    if (options.handoff_bits > 0) {
+        // blocked writers place the bits themselves instead of waiting for
+        // the next frame
+        handoff.reset(new HandoffRing(options.handoff_bits, options.overflow, boost::bind(&BinImg::sync, this)));
     }
 
     // set first pixel and default zoom (resize) 4x
     position = 0;
     resize = 4;
+    lod = 0;
+    tag = 0;
 
     // do not show disp_info as this state is blocking
     disp_info = false;
 
-    // create inital display, set title and zoom
-    disp = cimg_library::CImgDisplay(width, height, TITLE);
-    disp.resize(width*resize, height*resize, REDRAW);
+    // create inital display, set title and zoom (never in headless mode)
+    if (!headless) {
+        disp = cimg_library::CImgDisplay(width, height, TITLE);
+        disp.resize((width+gutter)*resize, height*resize, REDRAW);
+
+        // gray levels are shown as they are, no normalization
+        if (options.column_stats) {
+            stats_disp = cimg_library::CImgDisplay(width*resize, 2*STATS_HEIGHT*resize, "BinViz statistics", 0);
+        }
+    }
 
     /**
-     * clear image and set two dummy pixles (CImg does calculate a mean
-     * for some reason which causes the image to appear black even though
-     * it was filled with 128/half of the char unless a 0 and 255 pixel
-     * are set.
+     * the raster starts cleared, set two dummy pixles (CImg does calculate
+     * a mean for some reason which causes the image to appear black even
+     * though it was filled with 128/half of the char unless a 0 and 255
+     * pixel are set.
      */
-    fill(128);
     on(width-1,height-1);
     off(width-2,height-1);
-    update();
+
+    if (!headless) {
+        update();
+    }
+
+    // from now on the display is refreshed by the render thread only
+    render_thread.reset(new boost::thread(boost::bind(&BinImg::render, this)));
 }
 
 /**
- * @brief BinImg::consume one bit and process/display according to
- * start/stop/drop patterns. Note, drop patterns will have precedence
- * over start or stop patterns. Further note, the drop pattern will not be
- * applied when both, the start and stop pattern are defined.
- * @param in_byte to be consumed
+ * @brief BinImg::~BinImg stops the render thread, records the last
+ * (partial) line and exports the last (partial) image
  */
-void
-BinImg::consume(const unsigned char in_byte)
+BinImg::~BinImg()
 {
-    // move byte to queue
-    for (int i=7; i>=0; i--)
+    render_thread->interrupt();
+    render_thread->join();
+
+    // bits handed over after the last frame
+    sync();
+
     {
-        // check if current bit is true
-        if (in_byte & (1 << i))
-        {
-                queue.push_back(true);
-        }
-        else
-        {
-                queue.push_back(false);
+        boost::mutex::scoped_lock lock(img_mutex);
+
+        if (position % width() != 0) {
+            record(position / width(), position % width());
         }
+
+        exportFrame();
     }
 
-    // neither start nor end patterns have been defined
-    if (start.length() == 0 && end.length() == 0) {
+    // waits until all frames are written
+    exporter.reset();
+}
+
+/**
+ * @brief BinImg::render loop of the render thread. Polls display events and
+ * pushes the image to the display frame_rate times per second (if it
+ * changed). Writers never touch the display, they only draw into the
+ * image. In headless
+ * mode the image is dumped to disk instead. Timed frame exports are
+ * triggered here as well.
+ */
+void
+BinImg::render()
+{
+    boost::posix_time::time_duration period =
+        boost::posix_time::microseconds((long) (1e6 / frame_rate));
+    boost::posix_time::time_duration export_period =
+        boost::posix_time::microseconds((long) (1e6 * export_interval));
+    boost::posix_time::ptime next_export =
+        boost::posix_time::microsec_clock::universal_time() + export_period;
+
+    try {
+        while (true) {
+            boost::posix_time::ptime frame_start =
+                boost::posix_time::microsec_clock::universal_time();
+
+            // bits handed over since the last frame are placed first
+            if (handoff) {
+                boost::mutex::scoped_lock lock(img_mutex);
+                drain();
+            }
+
+            if (headless) {
+                dump();
+            }
+            else {
+                {
+                    boost::mutex::scoped_lock lock(img_mutex);
+                    update();
 
-        // clean stream of drop sequences recursively
-        if (drop.length() > 0) {
+                    if (column_stats && stats_dirty) {
+                        drawStats();
+                    }
+                }
+
+                // the upload does not hold up writers
+                if (upload) {
+                    zoomed.display(disp);
+                    upload = false;
+                }
 
-            int pos = 0; // assure the loop runs once
+                if (stats_upload) {
+                    stats_img.display(stats_disp);
+                    stats_upload = false;
+                }
+            }
 
-            while ((pos = detectPattern(drop)) > -1) {
-                remove(drop.length(),pos);
+            if (exporter && export_interval > 0
+                && boost::posix_time::microsec_clock::universal_time() >= next_export) {
+                boost::mutex::scoped_lock lock(img_mutex);
+                exportFrame();
+                next_export += export_period;
             }
+
+            double took = (boost::posix_time::microsec_clock::universal_time() - frame_start).total_microseconds() / 1e6;
+
+            {
+                boost::mutex::scoped_lock lock(img_mutex);
+
+                nr_frames++;
+                frame_time += took;
+
+                if (took > max_frame_time) {
+                    max_frame_time = took;
+                }
+            }
+
+            // sleep is an interruption point, the destructor stops us here
+            boost::this_thread::sleep(period);
         }
+    }
+    catch (boost::thread_interrupted &) {
+        // regular shutdown
+    }
+}
 
-        // display all bits immediately
-        while(queue.size() > 0) {
+/**
+ * @brief BinImg::width
+ * @return the number of dots per row
+ */
+int
+BinImg::width() const
+{
+    return raster.width();
+}
+
+/**
+ * @brief BinImg::height
+ * @return the number of rows
+ */
+int
+BinImg::height() const
+{
+    return raster.height();
+}
 
-            // set bit at position
-            set(queue.front());
+/**
+ * @brief BinImg::dump writes the image to dump_file if it changed since the
+ * last dump. The packed raster is copied while img_mutex is held, it is
+ * expanded and written afterwards.
+ */
+void
+BinImg::dump()
+{
+    if (dump_file.empty()) {
+        return;
+    }
 
-            // remove bit from queue
-            queue.pop_front();
+    BitRaster copy(0, 0);
+
+    {
+        boost::mutex::scoped_lock lock(img_mutex);
+
+        if (!dirty) {
+            return;
         }
+
+        copy = raster;
+        dirty = false;
+    }
+
+    writeRaster(copy, dump_file);
+}
+
+/**
+ * @brief BinImg::save writes the image to a file (PGM) right away, e.g.
+ * in headless mode without dump_file. Bits still in the hand-off ring are
+ * not placed yet (see sync()).
+ * @param file written
+ * @return true on success
+ */
+bool
+BinImg::save(const std::string &file)
+{
+    BitRaster copy(0, 0);
+
+    {
+        boost::mutex::scoped_lock lock(img_mutex);
+
+        copy = raster;
+    }
+
+    return writeRaster(copy, file);
+}
+
+/**
+ * @brief BinImg::writeRaster expands a raster and writes it to a file
+ * (PGM). The file is written under a temporary name and renamed into place
+ * so that readers never see a partial image.
+ * @param raster written
+ * @param file written
+ * @return true on success
+ */
+bool
+BinImg::writeRaster(const BitRaster &raster, const std::string &file)
+{
+    cimg_library::CImg<unsigned char> frame(raster.width(), raster.height(), 1, 1);
+    raster.expand(frame.data());
+
+    std::string tmp_file = file + ".tmp";
+
+    try {
+        frame.save_pnm(tmp_file.c_str());
+    }
+    catch (cimg_library::CImgException &e) {
+        std::cerr << "BinViz: writing " << file << " failed: " << e.what() << std::endl;
+
+        return false;
+    }
+
+    return std::rename(tmp_file.c_str(), file.c_str()) == 0;
+}
+
+/**
+ * @brief BinImg::exportFrame hands the image over to the exporter if it
+ * changed since the last export. Only the image is copied, the exporter
+ * writes it on its own thread. The caller has to hold img_mutex.
+ */
+void
+BinImg::exportFrame()
+{
+    if (!exporter || !export_dirty) {
+        return;
+    }
+
+    expanded.assign(width(), height(), 1, 1);
+    raster.expand(expanded.data());
+
+    exporter->submit(expanded);
+    export_dirty = false;
+}
+
+/**
+ * @brief BinImg::record appends a line of the image to the scrollback and
+ * the column statistics
+ * @param row of the image
+ * @param nr_pixels number of dots the cursor placed on the line
+ */
+void
+BinImg::record(int row, int nr_pixels)
+{
+    if (row >= height()) {
+        return;
+    }
+
+    if (!scrollback && !column_stats) {
+        return;
+    }
+
+    raster.expand(row, &line[0]);
+
+    if (scrollback) {
+        scrollback->append(&line[0], nr_pixels);
+    }
+
+    if (column_stats) {
+        column_stats->add(&line[0], nr_pixels);
+        stats_dirty = true;
+    }
+}
+
+/**
+ * @brief BinImg::indexPacket remembers where and when a packet starts and
+ * appends it to the packet index once it ends
+ * @param event PACKET_START or PACKET_END
+ */
+void
+BinImg::indexPacket(const FrameEvent &event)
+{
+    if (!packet_index) {
+        return;
+    }
+
+    // the cursor is on the first line of the packet
+    if (event.type == FrameEvent::PACKET_START) {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+
+        packet.offset = event.offset;
+        packet.line = scrollback ? scrollback->lines() : 0;
+        packet.timestamp = now.tv_sec * 1000000ULL + now.tv_usec;
+        packet.tag = event.tag;
+    }
+    else {
+        packet.length = event.length;
+        packet_index->append(packet);
+    }
+}
+
+/**
+ * @brief BinImg::fetchColumnStats reads the column statistics, see
+ * ColumnStats::get()
+ * @param frequency receives the share of ones per column, empty if column
+ * statistics are disabled
+ * @param entropy receives the binary entropy per column, empty if column
+ * statistics are disabled
+ */
+void
+BinImg::fetchColumnStats(std::vector<double> &frequency, std::vector<double> &entropy)
+{
+    boost::mutex::scoped_lock lock(img_mutex);
+
+    if (!column_stats) {
+        frequency.clear();
+        entropy.clear();
+        return;
+    }
+
+    column_stats->get(frequency, entropy);
+}
+
+/**
+ * @brief BinImg::fetchFrameTimes reads the time the render thread spent on
+ * frames so far (placing handed over bits, display update or dump, upload
+ * and exports), e.g. for benchmarks
+ * @param nr_frames receives the number of frames rendered
+ * @param mean receives the mean time per frame in seconds
+ * @param max receives the longest time of a frame in seconds
+ */
+void
+BinImg::fetchFrameTimes(uint64_t &nr_frames, double &mean, double &max)
+{
+    boost::mutex::scoped_lock lock(img_mutex);
+
+    nr_frames = this->nr_frames;
+    mean = this->nr_frames ? frame_time / this->nr_frames : 0;
+    max = max_frame_time;
+}
+
+/**
+ * @brief BinImg::packets
+ * @return the number of packets indexed so far
+ */
+uint64_t
+BinImg::packets()
+{
+    boost::mutex::scoped_lock lock(img_mutex);
+
+    return packet_index ? packet_index->packets() : 0;
+}
+
+/**
+ * @brief BinImg::fetchPacket reads a packet back from the scrollback. The
+ * packet is looked up in the index, its lines are read from the mapped
+ * scrollback directly, no other packet is touched.
+ * @param nr of the packet (0 is the first packet)
+ * @param bits receives the packet packed at 8 bits per byte, most
+ * significant bit first (e.g. for detectStart())
+ * @return the number of bits of the packet, -1 if there is no such packet
+ * or no scrollback to read it from
+ */
+int64_t
+BinImg::fetchPacket(uint64_t nr, std::vector<unsigned char> &bits)
+{
+    boost::mutex::scoped_lock lock(img_mutex);
+
+    PacketRecord record;
+
+    if (!packet_index || !scrollback || !packet_index->get(nr, record)) {
+        return -1;
     }
-    // only end pattern is defined
-    else if (start.length() == 0 && end.length() > 0) {
 
-        // clean stream of drop sequences recursively
-        if (drop.length() > 0) {
+    bits.assign((record.length + 7) / 8, 0);
+
+    uint32_t nr_bits = 0;
 
-            int pos = 0; // assure the loop runs once
+    // the packet continues on the next line where a line ends
+    for (uint64_t line=record.line; nr_bits < record.length && line < scrollback->lines(); line++) {
+        uint32_t nr_pixels = scrollback->length(line);
+        const unsigned char *dots = scrollback->bits(line);
 
-            while ((pos = detectPattern(drop)) > -1) {
-                remove(drop.length(),pos);
+        for (uint32_t i=0; i < nr_pixels && nr_bits < record.length; i++, nr_bits++) {
+            if (dots[i / 8] & (0x80 >> (i % 8))) {
+                bits[nr_bits / 8] |= 0x80 >> (nr_bits % 8);
             }
         }
+    }
+
+    return nr_bits == record.length ? (int64_t) nr_bits : -1;
+}
+
+/**
+ * @brief BinImg::showPacket scrolls the display back to the first line of
+ * a packet, keys continue browsing from there (see browse())
+ * @param nr of the packet (0 is the first packet)
+ */
+void
+BinImg::showPacket(uint64_t nr)
+{
+    boost::mutex::scoped_lock lock(img_mutex);
+
+    PacketRecord record;
+
+    if (!packet_index || !scrollback || !packet_index->get(nr, record)) {
+        return;
+    }
+
+    history_top = record.line;
+    in_history = true;
+}
+
+/**
+ * @brief BinImg::consume one byte and process/display according to
+ * start/stop/drop patterns. See Framer::process() for details.
+ * @param in_byte to be consumed
+ */
+void
+BinImg::consume(const unsigned char in_byte)
+{
+    // the hand-off ring needs no lock
+    boost::mutex::scoped_lock lock(img_mutex, boost::defer_lock);
 
-        /**
-         * improve speed by not searching the whole queue as we
-         * searched the queue allready with the last 8 bit consumed
-         */
-        int skip = queue.size() - 8 - (end.length() - 1);
+    if (!handoff) {
+        lock.lock();
+    }
+
+    framer.consume(in_byte);
+    deliver();
+}
+
+/**
+ * @brief BinImg::consume a whole buffer of bytes in one pass. The buffer
+ * is framed first, framed bits are placed (or handed over to the render
+ * thread) afterwards exactly as consume(const unsigned char) would do.
+ * @param in pointer to the first byte to be consumed
+ * @param len number of bytes (bits if the input is unpacked) to be consumed
+ */
+void
+BinImg::consume(const unsigned char *in, size_t len)
+{
+    // without hand-off ring lock once for the whole buffer, the render
+    // thread waits meanwhile
+    boost::mutex::scoped_lock lock(img_mutex, boost::defer_lock);
 
-        // detect end
-        int pos_end = detectEnd(skip);
+    if (!handoff) {
+        lock.lock();
+    }
 
-        // check if end detected
-        if (pos_end > -1) {
+    framer.consume(in, len);
+    deliver();
+}
+
+/**
+ * @brief BinImg::markStart starts a line (or a packet if end marks are
+ * used too) in front of the next byte consumed. See Framer::markStart().
+ */
+void
+BinImg::markStart()
+{
+    boost::mutex::scoped_lock lock(img_mutex, boost::defer_lock);
+
+    if (!handoff) {
+        lock.lock();
+    }
+
+    framer.markStart();
+    deliver();
+}
 
-            // display bits until end pattern
-            flush(pos_end);
+/**
+ * @brief BinImg::markEnd wraps to a new line (or ends a packet if start
+ * marks are used too) in front of the next byte consumed. See
+ * Framer::markEnd().
+ */
+void
+BinImg::markEnd()
+{
+    boost::mutex::scoped_lock lock(img_mutex, boost::defer_lock);
+
+    if (!handoff) {
+        lock.lock();
+    }
+
+    framer.markEnd();
+    deliver();
+}
+
+/**
+ * @brief BinImg::deliver hands the bits framed so far over to the render
+ * thread or, without hand-off ring, places them right away (the caller has
+ * to hold img_mutex then)
+ */
+void
+BinImg::deliver()
+{
+    if (handoff) {
+        handoff->push(framer.bits(), framer.getEvents());
+    }
+    else {
+        place(framer.bits(), framer.getEvents());
+    }
+
+    framer.clear();
+}
 
-            // wrap to next line of image
+/**
+ * @brief BinImg::drain places the bits taken from the hand-off ring. The
+ * caller has to hold img_mutex, it keeps the ring to a single consumer.
+ */
+void
+BinImg::drain()
+{
+    if (!handoff) {
+        return;
+    }
+
+    handoff->pop(handed, handed_events);
+    place(handed, handed_events);
+
+    handed.clear();
+    handed_events.clear();
+}
+
+/**
+ * @brief BinImg::place displays framed bits and handles the events in
+ * between (wrap to a new line, packets). Bits and events may be split
+ * anywhere, the next call continues where the last one stopped. The caller
+ * has to hold img_mutex.
+ * @param bits framed
+ * @param events in between the bits (see Framer::getEvents())
+ */
+void
+BinImg::place(const BitQueue &bits, const std::vector<FrameEvent> &events)
+{
+    size_t done = 0;
+
+    for (size_t i=0; i <= events.size(); i++) {
+        size_t pos = i < events.size() ? events[i].pos : bits.size();
+
+        // display bits up to the event in one go
+        if (!skipping) {
+            putBits(bits, done, pos - done);
+        }
+
+        done = pos;
+
+        if (i == events.size()) {
+            break;
+        }
+
+        place(events[i]);
+    }
+}
+
+/**
+ * @brief BinImg::place handles an event in between the bits displayed. The
+ * caller has to hold img_mutex.
+ * @param event to be handled
+ */
+void
+BinImg::place(const FrameEvent &event)
+{
+    // bits were dropped by the hand-off ring, continue on a new line. A
+    // packet cut short is neither indexed nor remembered.
+    if (event.type == FrameEvent::GAP) {
+        if (position % width() != 0) {
             wrapPosition();
         }
 
-        // keep start.length()-1 bits as these might match next time
-        flushPartial(end.length());
+        skipping = false;
+        packet_open = false;
+
+        return;
     }
-    // only start pattern is defined
-    else if (start.length() > 0 && end.length() == 0) {
 
-        // clean stream of drop sequences recursively
-        if (drop.length() > 0) {
+    // a repeated packet is only counted, skip its bits, its end and the
+    // wrap behind
+    if (skipping) {
+        skipping = event.type != FrameEvent::WRAP;
 
-            int pos = 0; // assure the loop runs once
+        return;
+    }
 
-            while ((pos = detectPattern(drop)) > -1) {
-                remove(drop.length(),pos);
-            }
+    // lines are shaded by the start pattern they start with
+    if (event.type == FrameEvent::WRAP || event.type == FrameEvent::PACKET_START) {
+        tag = event.tag;
+    }
+
+    if (event.type == FrameEvent::WRAP) {
+        wrapPosition();
+    }
+    else if (event.type == FrameEvent::PACKET_START && repeat(event)) {
+        skipping = true;
+    }
+    else if (event.type == FrameEvent::PACKET_START) {
+        packet_open = true;
+        indexPacket(event);
+
+        if (gutter) {
+            // the cursor may be behind the last row (wrapped there)
+            packet_row = position / width() % height();
+            packet_hash = event.hash;
         }
+    }
+    else if (packet_open) {
+        packet_open = false;
+        indexPacket(event);
 
-        /**
-         * improve speed by not searching the whole queue as we
-         * searched the queue allready with the last 8 bit consumed
-         */
-        int skip = queue.size() - 8 - (start.length() - 1);
+        if (gutter) {
+            remember();
+        }
+    }
+}
 
-        // detect start
-        int pos_start = detectStart(skip);
+/**
+ * @brief BinImg::repeat looks up a packet among the packets displayed and
+ * counts it if it is shown already. The caller has to hold img_mutex.
+ * @param event PACKET_START of the packet
+ * @return true if the packet is a repeat and must not be displayed
+ */
+bool
+BinImg::repeat(const FrameEvent &event)
+{
+    if (!gutter || !event.hash) {
+        return false;
+    }
 
-        // check if detected
-        if (pos_start > -1) {
+    boost::unordered_map<uint64_t, int>::iterator packet = seen.find(event.hash);
 
-            // display bits in front of start pattern
-            flush(pos_start);
+    if (packet == seen.end()) {
+        return false;
+    }
 
-            // wrap to next line
-            wrapPosition();
+    int row = packet->second;
 
-            // display start pattern
-            flush(start.length());
-        }
+    row_repeats[row]++;
 
-        // keep start.length()-1 bits as these might match next time
-        flushPartial(start.length());
+    // the gutter of the row has to be scaled and uploaded again
+    if (row < dirty_top) {
+        dirty_top = row;
+    }
+
+    if (row >= dirty_bottom) {
+        dirty_bottom = row + 1;
     }
-    // start and end pattern are defined
-    else {
 
-        int pos = -1;
+    return true;
+}
+
+/**
+ * @brief BinImg::remember the packet just displayed (cursor behind its last
+ * bit). Rows it overwrote forget the packets shown there before. The
+ * caller has to hold img_mutex.
+ */
+void
+BinImg::remember()
+{
+    int last_row = position > 0 ? (position - 1) / width() : height() - 1;
 
-        // detect start or end depending on state
-        if (in_packet) {
-            /**
-             * improve speed by not searching the whole queue as we
-             * searched the queue allready with the last 8 bit consumed
-             */
-            int skip = queue.size() - 8 - (end.length() - 1);
+    for (int row=packet_row; ; row = (row + 1) % height()) {
+        forget(row);
 
-            pos = detectEnd(skip);
+        if (row == last_row) {
+            break;
         }
-        else {
-            /**
-             * improve speed by not searching the whole queue as we
-             * searched the queue allready with the last 8 bit consumed
-             */
-            int skip = queue.size() - 8 - (start.length() - 1);
+    }
+
+    // packets flushed before their end are not hashed
+    if (packet_hash) {
+        row_hash[packet_row] = packet_hash;
+        seen[packet_hash] = packet_row;
+    }
+}
+
+/**
+ * @brief BinImg::forget the packet shown on a row, once it is overwritten
+ * it is displayed again on its next repeat
+ * @param row of the image
+ */
+void
+BinImg::forget(int row)
+{
+    if (row_hash[row]) {
+        seen.erase(row_hash[row]);
+        row_hash[row] = 0;
+    }
+
+    row_repeats[row] = 0;
+}
+
+/**
+ * @brief BinImg::repeats
+ * @param row of the image
+ * @return how often the packet shown on the row was repeated (0 if there
+ * is no packet or dedup is off)
+ */
+uint32_t
+BinImg::repeats(int row)
+{
+    boost::mutex::scoped_lock lock(img_mutex);
 
-            pos = detectStart(skip);
-        }
+    if (!gutter || row < 0 || row >= height()) {
+        return 0;
+    }
 
-        // check detected ?
-        if (pos > -1) {
+    return row_repeats[row];
+}
 
-            // flush bits from start to end or remove bits after end until start
-            if (in_packet) {
-                flush(pos);
-            }
-            else {
-                remove(pos);
-            }
+/**
+ * @brief BinImg::putLine displays a line framed elsewhere (e.g. by the
+ * MultiFramer) and continues on the next line. Lines longer than the image
+ * is wide continue on the next line as well.
+ * @param bits of the line
+ */
+void
+BinImg::putLine(const BitQueue &bits)
+{
+    boost::mutex::scoped_lock lock(img_mutex);
 
-            // display start pattern or wrap after end pattern
-            if (!in_packet) {
-                flush(start.length());
-            }
-            else {
-                // wrap line
-                wrapPosition();
-            }
+    putBits(bits, 0, bits.size());
 
-            // switch state as we found pattern
-            in_packet = !in_packet;
-        }
+    // an empty line still takes a row, a full line already wrapped
+    if (bits.empty() || position % width() != 0) {
+        wrapPosition();
     }
 }
 
@@ -242,8 +842,10 @@ BinImg::consume(const unsigned char in_byte)
 void
 BinImg::set(int x, int y, const unsigned char color[])
 {
-    draw_point(x, y, color);
-    update();
+    boost::mutex::scoped_lock lock(img_mutex);
+
+    raster.set(x, y, color[0]);
+    markDirty(y, y + 1);
 }
 
 /**
@@ -253,12 +855,92 @@ BinImg::set(int x, int y, const unsigned char color[])
  */
 void
 BinImg::set(int position, const unsigned char color[])
+{
+    boost::mutex::scoped_lock lock(img_mutex);
+
+    draw(position, color);
+}
+
+/**
+ * @brief BinImg::getPixel reads a dot of the image, bits still in the
+ * hand-off ring are not placed yet (see sync())
+ * @param x the x-coordinate of the pixel
+ * @param y the y-coordinate of the pixel
+ * @return the gray shade: ON (or a darker on shade of tagged lines), OFF
+ * or CLEAR if the dot was not drawn
+ */
+unsigned char
+BinImg::getPixel(int x, int y)
+{
+    boost::mutex::scoped_lock lock(img_mutex);
+
+    return raster.get(x, y);
+}
+
+/**
+ * @brief BinImg::getPosition
+ * @return the position of the cursor, the dot drawn next (row by row from
+ * the top left corner)
+ */
+int
+BinImg::getPosition()
+{
+    boost::mutex::scoped_lock lock(img_mutex);
+
+    return position;
+}
+
+/**
+ * @brief BinImg::draw position to color without locking, the display is
+ * updated by the render thread
+ * @param position to be set
+ * @param color the gray shade. eg. {128}
+ */
+void
+BinImg::draw(int position, const unsigned char color[])
 {
     int x = position % width();
     int y = position / width();
 
-    draw_point(x, y, color);
-    update();
+    raster.set(x, y, color[0]);
+    markDirty(y, y + 1);
+}
+
+/**
+ * @brief BinImg::markDirty marks rows to be shown, dumped and exported
+ * again. Rows outside the image are ignored.
+ * @param top the first row changed
+ * @param bottom the row behind the last row changed
+ */
+void
+BinImg::markDirty(int top, int bottom)
+{
+    dirty = true;
+    export_dirty = true;
+
+    if (top < 0) {
+        top = 0;
+    }
+
+    if (bottom > height()) {
+        bottom = height();
+    }
+
+    if (top >= bottom) {
+        return;
+    }
+
+    if (pyramid) {
+        pyramid->invalidate(top, bottom);
+    }
+
+    if (top < dirty_top) {
+        dirty_top = top;
+    }
+
+    if (bottom > dirty_bottom) {
+        dirty_bottom = bottom;
+    }
 }
 
 /**
@@ -304,30 +986,78 @@ BinImg::off(int position)
 }
 
 /**
- * @brief BinImg::clear gray out pixel at specific position
- * @param position of the pixel (lu-corner position is 0)
+ * @brief BinImg::set current bit on or off and increment position
+ * @param on true to show bit as on, false to show bit as off
  */
 void
-BinImg::clear(int position) {
-    set(position, CLEAR);
+BinImg::set(bool state)
+{
+    boost::mutex::scoped_lock lock(img_mutex);
+
+    put(state);
 }
 
 /**
- * @brief BinImg::set current bit on or off and increment position
+ * @brief BinImg::put current bit on or off and increment position. The
+ * caller has to hold img_mutex.
  * @param on true to show bit as on, false to show bit as off
  */
 void
-BinImg::set(bool state)
+BinImg::put(bool state)
+{
+    draw(curPosition(), state ? TAGGED[tag % NR_TAGGED] : OFF);
+
+    // next position from queue
+    incPosition();
+}
+
+/**
+ * @brief BinImg::putBits displays a run of bits at the cursor and moves it
+ * behind them. The run is drawn row by row, a word of dots at a time, and
+ * continues on the top row once the image is full (exactly as put() bit
+ * by bit). The caller has to hold img_mutex.
+ * @param bits to be displayed
+ * @param first position of the first bit in bits
+ * @param nr_bits number of bits displayed
+ */
+void
+BinImg::putBits(const BitQueue &bits, size_t first, size_t nr_bits)
 {
-    if(state) {
-        on(curPosition());
+    if (nr_bits == 0) {
+        return;
+    }
+
+    // the rows up to the end of the run, all rows if it wraps to the top
+    if (position + nr_bits >= (size_t) getMaxPosition()) {
+        markDirty(0, height());
     }
     else {
-        off(curPosition());
+        markDirty(position / width(), (position + nr_bits - 1) / width() + 1);
     }
 
-    // next position from queue
-    incPosition();
+    while (nr_bits > 0) {
+        int x = position % width();
+        int y = position / width();
+
+        // the last row ends in front of the dummy pixel
+        int nr_dots = (y == height() - 1 ? getMaxPosition() : (y + 1) * width()) - position;
+
+        if ((size_t) nr_dots > nr_bits) {
+            nr_dots = nr_bits;
+        }
+
+        raster.write(x, y, bits, first, nr_dots, TAGGED[tag % NR_TAGGED][0]);
+
+        // the image may have been exported by the wrap behind the last row
+        export_dirty = true;
+
+        first += nr_dots;
+        nr_bits -= nr_dots;
+
+        // wraps (and records the line) once the cursor leaves the row
+        position += nr_dots - 1;
+        incPosition();
+    }
 }
 
 /**
@@ -362,8 +1092,21 @@ BinImg::incPosition()
     // wrap around; point to the top of the image if we reached the end
     if (position >= getMaxPosition())
     {
+        // the last line ends in front of the dummy pixel
+        if (position == getMaxPosition()) {
+            record(height() - 1, width() - 1);
+        }
+
+        // the image is complete, export it before it is overwritten
+        exportFrame();
+
         position = 0;
     }
+    // the cursor left a complete line
+    else if (position % width() == 0)
+    {
+        record(position / width() - 1, width());
+    }
 }
 
 /**
@@ -377,19 +1120,33 @@ BinImg::curPosition()
 }
 
 /**
- * @brief BinImg::wrapPosition to next line
+ * @brief BinImg::wrapPosition to next line, the rest of the row is cleared
+ * at once. The row below the last one is the top row.
  * @return the position of the first pixel of the next row - CR LF :)
  */
 int
 BinImg::wrapPosition()
 {
-    int new_pos = position - (position % width()) + width();
+    int x = position % width();
+    int y = position / width();
+
+    // clear to the end of the row, the last row ends in front of the
+    // dummy pixel
+    raster.clear(x, y, (y == height() - 1 ? width() - 1 : width()) - x);
+    markDirty(y, y + 1);
+
+    // the line ends at the cursor
+    record(y, x);
+
+    position = (y + 1) * width();
 
-    for (int i = position; i < new_pos; i++) {
-        clear(i);
+    // the image is complete, export it before it is overwritten
+    if (position >= getMaxPosition()) {
+        exportFrame();
+        position = 0;
     }
 
-    position = new_pos;
+    return position;
 }
 
 /**
@@ -411,7 +1168,7 @@ BinImg::nextPosition()
 }
 
 /**
- * @brief BinImg::update display. sets title, takes care of resizing (mouse
+ * @brief BinImg::update display, only called by the render thread. sets title, takes care of resizing (mouse
  * wheel) as well as mouse clicks and key events
  */
 void
@@ -420,9 +1177,38 @@ BinImg::update() {
     // mouse wheel
     if (disp.wheel()) {
 
-        // wheel counter should be something else but 0
-        resize += disp.wheel();
-        disp.resize(width()*resize, height()*resize, REDRAW);
+        // wheel counter should be something else but 0. Below one pixel
+        // per dot each step halves the image (level of detail).
+        for (int step=disp.wheel(); step != 0; step += step > 0 ? -1 : 1) {
+            if (step > 0 && lod > 0) {
+                lod--;
+            }
+            else if (step > 0) {
+                resize++;
+            }
+            else if (resize > 1) {
+                resize--;
+            }
+            else if (lod < DensityPyramid::MAX_LEVEL) {
+                lod++;
+            }
+        }
+
+        if (lod > 0 && !pyramid) {
+            pyramid.reset(new DensityPyramid(width(), height()));
+        }
+
+        disp.resize(zoomWidth(), zoomHeight(), REDRAW);
+
+        // scale and upload the whole image at the new size
+        dirty_top = 0;
+        dirty_bottom = height();
+
+        // the heatmap follows the zoom
+        if (column_stats) {
+            stats_disp.resize(width()*resize, 2*STATS_HEIGHT*resize, REDRAW);
+            stats_dirty = true;
+        }
 
         // clear wheel counter
         disp.set_wheel();
@@ -438,212 +1224,435 @@ BinImg::update() {
         disp.set_button();
     }
 
+    // keys scroll through the recorded lines
+    if (scrollback && disp.key()) {
+        browse(disp.key());
+
+        // clear keys
+        disp.set_key();
+    }
+
     refresh();
 }
 
+/**
+ * @brief BinImg::browse moves through the recorded lines. Page up/down and
+ * arrow up/down scroll by a screen or a line, home jumps to the oldest
+ * line, end (or scrolling down past the most recent line) returns to the
+ * live image.
+ * @param key code of the key pressed
+ */
+void
+BinImg::browse(unsigned int key)
+{
+    uint64_t nr_lines = scrollback->lines();
+    uint64_t last_top = nr_lines > (uint64_t) height() ? nr_lines - height() : 0;
+
+    // start browsing at the most recent lines
+    if (!in_history) {
+        history_top = last_top;
+    }
+
+    if (key == cimg_library::cimg::keyPAGEUP) {
+        history_top -= history_top < (uint64_t) height() ? history_top : height();
+    }
+    else if (key == cimg_library::cimg::keyARROWUP) {
+        history_top -= history_top > 0 ? 1 : 0;
+    }
+    else if (key == cimg_library::cimg::keyPAGEDOWN) {
+        history_top += height();
+    }
+    else if (key == cimg_library::cimg::keyARROWDOWN) {
+        history_top++;
+    }
+    else if (key == cimg_library::cimg::keyHOME) {
+        history_top = 0;
+    }
+    else if (key == cimg_library::cimg::keyEND) {
+        history_top = last_top;
+    }
+
+    in_history = history_top < last_top;
+}
+
+/**
+ * @brief BinImg::drawHistory draws the recorded lines starting at
+ * history_top into the history image. Lines are read from the mapped
+ * scrollback, thus only the lines shown are paged in.
+ */
+void
+BinImg::drawHistory() {
+    uint64_t nr_lines = scrollback->lines();
+
+    history.assign(width(), height(), 1, 1);
+    history.fill(CLEAR[0]);
+
+    for (int y=0; y < height() && history_top + y < nr_lines; y++) {
+        uint32_t nr_pixels = scrollback->length(history_top + y);
+        const unsigned char *bits = scrollback->bits(history_top + y);
+        unsigned char *row = history.data(0, y);
+
+        for (uint32_t x=0; x < nr_pixels; x++) {
+            row[x] = (bits[x / 8] & (0x80 >> (x % 8))) ? ON[0] : OFF[0];
+        }
+    }
+
+    // same dummy pixels as the image, see constructor
+    history(width() - 1, height() - 1) = ON[0];
+    history(width() - 2, height() - 1) = OFF[0];
+}
+
+/**
+ * @brief BinImg::drawStats draws the column statistics as heatmap, the
+ * frequency of ones on top and the entropy below (white is all ones or 1
+ * bit of entropy). Columns are scaled by resize like the image. The
+ * caller has to hold img_mutex.
+ */
+void
+BinImg::drawStats() {
+    std::vector<double> frequency;
+    std::vector<double> entropy;
+
+    column_stats->get(frequency, entropy);
+
+    int stats_height = STATS_HEIGHT * resize;
+
+    stats_img.assign(width() * resize, 2 * stats_height, 1, 1);
+
+    unsigned char *top = stats_img.data(0, 0);
+    unsigned char *bottom = stats_img.data(0, stats_height);
+
+    for (int x=0; x < width(); x++) {
+        memset(top + x * resize, (unsigned char) (frequency[x] * 255 + 0.5), resize);
+        memset(bottom + x * resize, (unsigned char) (entropy[x] * 255 + 0.5), resize);
+    }
+
+    // repeat the first row of both heatmaps
+    for (int y=1; y < stats_height; y++) {
+        memcpy(stats_img.data(0, y), top, stats_img.width());
+        memcpy(stats_img.data(0, stats_height + y), bottom, stats_img.width());
+    }
+
+    stats_disp.set_title(STATS_TITLE, (unsigned long long) column_stats->lines());
+
+    stats_dirty = false;
+    stats_upload = true;
+}
+
 /**
  * @brief BinImg::refresh handles selection state when user selects and
- * zooms part of the image.
+ * zooms part of the image. Shows recorded lines while browsing the
+ * history.
  */
 void
 BinImg::refresh() {
+
+    // show recorded lines instead of the image while browsing the history
+    if (in_history) {
+        drawHistory();
+    }
+    // the paused display shows the image at its own zoom
+    else if (disp_info) {
+        expanded.assign(width(), height(), 1, 1);
+        raster.expand(expanded.data());
+    }
+
+    const cimg_library::CImg<unsigned char> &shown = in_history ? history : expanded;
+
     if (disp_info) {
         disp.set_title("Paused, ESC to continue");
-        display(disp, disp_info);
+        shown.display(disp, disp_info);
 
         // immediately return to non-blocking mode, when
         // user escapes (ESC) disp_info mode
         disp_info = false;
     }
+    else if (in_history) {
+        disp.set_title("History, line %llu of %llu, END to continue", (unsigned long long) history_top + 1, (unsigned long long) scrollback->lines());
+        shown.display(disp);
+    }
+    // nothing changed, the window keeps showing the last upload
+    else if (dirty_top >= dirty_bottom) {
+        return;
+    }
     else {
         disp.set_title(TITLE);
-        display(disp);
+        zoom();
+        upload = true;
+        return;
     }
+
+    // the live image has to be uploaded again once it is shown
+    dirty_top = 0;
+    dirty_bottom = height();
 }
 
 /**
- * @brief BinImg::wait until a keyboard or mouse event occurs
+ * @brief BinImg::zoomWidth
+ * @return the width of the image (and gutter) on screen
  */
-void
-BinImg::wait() {
-    disp.wait();
-}
+int
+BinImg::zoomWidth() {
+    if (lod > 0) {
+        return ((width() - 1) >> lod) + 1;
+    }
 
+    return (width() + gutter) * resize;
+}
 
 /**
- * @brief BinImg::detectPattern
- * @param pattern to search for
- * @param start_pos improve speed by start searching from start_pos
- * @return -1 if not matched or vposition that matched (0 for first pos.)
+ * @brief BinImg::zoomHeight
+ * @return the height of the image on screen
  */
 int
-BinImg::detectPattern(const std::string &pattern, int start_pos) {
+BinImg::zoomHeight() {
+    if (lod > 0) {
+        return ((height() - 1) >> lod) + 1;
+    }
 
-    // for each bit in the queue check pattern
-    int match = -1;
-    int queue_pos = -1;
+    return height() * resize;
+}
 
-    // assure start_pos fits valid range otherwise search whole queue
-    if (start_pos < 0 || start_pos >= queue.size()) {
-        start_pos=0;
+/**
+ * @brief BinImg::zoom expands the changed rows of the raster and scales
+ * them by resize into zoomed, the display does not have to rescale the
+ * whole image then. Pixels are repeated resize times per row, the first
+ * scaled row is copied to the other resize-1 rows. Zoomed out, the
+ * changed rows are counted into the pyramid and the rows of its level
+ * covering them are drawn (without gutter, rows of repeats are merged).
+ */
+void
+BinImg::zoom() {
+    int zoom_width = zoomWidth();
+    int zoom_height = zoomHeight();
+
+    // zoom changed, scale all rows
+    if (zoomed.width() != zoom_width || zoomed.height() != zoom_height) {
+        zoomed.assign(zoom_width, zoom_height, 1, 1);
+        dirty_top = 0;
+        dirty_bottom = height();
     }
 
-    /**
-     * Iterate trough queue and try to match the pattern. Iteration will
-     * run until queue.size() - len_pattern bits are left since the pattern
-     * can't match less queued bits than the pattern itself. For efficiency
-     * reasons, the start position could be shifted by start_pos. This will
-     * allow to skip bits that have already searched before.
-     */
-    for(queue_pos=start_pos; queue_pos < queue.size() - (pattern.length() - 1); queue_pos++) {
-
-        int len_queue = queue.size() - queue_pos;
+    if (lod > 0) {
+        pyramid->update(raster);
 
-        // pattern can't mach if queue is shorter than pattern
-        if (len_queue < pattern.length()) {
-            return -1;
+        for (int y=dirty_top >> lod; y <= (dirty_bottom - 1) >> lod; y++) {
+            pyramid->draw(raster, lod, y, zoomed.data(0, y));
         }
 
+        dirty_top = height();
+        dirty_bottom = 0;
 
-        for(int pattern_pos=0; pattern_pos < pattern.length(); pattern_pos++) {
+        return;
+    }
 
-            // in each queue element, check if pattern matches
-            if (queue.at(pattern_pos+queue_pos) == true
-                    && pattern[pattern_pos] == '1'
-                    || queue.at(pattern_pos+queue_pos) == false
-                    && pattern[pattern_pos] == '0') {
+    for (int y=dirty_top; y < dirty_bottom; y++) {
+        unsigned char *row = zoomed.data(0, y * resize);
 
-                /**
-                 * bit matches... check whether we successfully iterated
-                 * through the whole pattern
-                 */
-                if (pattern_pos == pattern.length() -1) {
-                    return queue_pos;
-                }
-            }
-            else {
-                // bit did not match... continue to shift queue
-                break;
+        // unscaled rows are expanded in place
+        if (resize == 1) {
+            raster.expand(y, row);
+        }
+        else {
+            raster.expand(y, &line[0]);
+
+            for (int x=0; x < width(); x++) {
+                memset(row + x * resize, line[x], resize);
             }
         }
+
+        if (gutter) {
+            drawGutter(row + width() * resize, y);
+        }
+
+        for (int i=1; i < resize; i++) {
+            memcpy(zoomed.data(0, y * resize + i), row, zoom_width);
+        }
     }
 
-    return -1;
+    dirty_top = height();
+    dirty_bottom = 0;
 }
 
 /**
- * @brief BinImg::detectStart detects start pattern
- * @return position of left most pattern bit if detected otherwise -1
+ * @brief BinImg::drawGutter draws the repeat count of a row in binary
+ * (most significant bit first, counts above 16 bits saturate). The first
+ * column separates the gutter from the image, leading zeros are gray.
+ * @param row of zoomed to draw into, right of the image
+ * @param y the row of the image
  */
-int
-BinImg::detectStart(int start_pos=0) {
-    return detectPattern(start, start_pos);
+void
+BinImg::drawGutter(unsigned char *row, int y) {
+    uint32_t count = row_repeats[y] < 0xffff ? row_repeats[y] : 0xffff;
+    bool leading = true;
+
+    memset(row, CLEAR[0], resize);
+
+    for (int i=1; i < gutter; i++) {
+        bool bit = (count >> (gutter - 1 - i)) & 1;
+
+        leading = leading && !bit;
+        memset(row + i * resize, leading ? CLEAR[0] : bit ? ON[0] : OFF[0], resize);
+    }
 }
 
 /**
- * @brief BinImg::detectEnd detects end pattern
- * @return position of right most pattern bit if detected otherwise -1
+ * @brief BinImg::wait until a keyboard or mouse event occurs, returns
+ * immediately in headless mode
  */
-int
-BinImg::detectEnd(int start_pos=0) {
-    int len_pattern = end.length();
-    int pos_pattern = detectPattern(end, start_pos);
-
-    if (pos_pattern > -1) {
-        return pos_pattern + len_pattern;
+void
+BinImg::wait() {
+    if (!headless) {
+        disp.wait();
     }
-
-    return -1;
 }
 
 /**
- * @brief BinImg::flush displays all queued bits immediately and will
- * result in an empty queue.
+ * @brief BinImg::key takes the key pressed last on the display, keys are
+ * taken by the render thread instead while there is a scrollback to
+ * browse
+ * @return the key code (e.g. cimg_library::cimg::keyPAGEDOWN), 0 if no key
+ * was pressed or in headless mode
  */
-void
-BinImg::flush() {
+unsigned int
+BinImg::key() {
+    if (headless) {
+        return 0;
+    }
 
-    while(queue.size()) {
-        // set bit at position
-        set(queue.front());
+    boost::mutex::scoped_lock lock(img_mutex);
 
-        // remove bit from queue
-        queue.pop_front();
-    }
+    unsigned int code = disp.key();
+
+    disp.set_key();
+
+    return code;
+}
+
+/**
+ * @brief BinImg::closed
+ * @return true if the display was closed (never in headless mode)
+ */
+bool
+BinImg::closed() {
+    return !headless && disp.is_closed();
 }
 
 /**
- * @brief BinImg::remove remove a number of bits from the front of the queue
- * @param nr_bits the number of bits popped from the front of the queue
- * @param position skip to this position and remove nr_bits starting at position. 0 if param is omitted.
+ * @brief BinImg::clear clears the image and returns the cursor to the top
+ * left corner, e.g. to show another part of a stream by putLine()
  */
 void
-BinImg::remove(int nr_bits, int position) {
+BinImg::clear() {
+    boost::mutex::scoped_lock lock(img_mutex);
 
-    // check bounds position and nr_bits
-    if (position < queue.size() && position >= 0
-        && nr_bits >= 1 && nr_bits + position <= queue.size()) {
+    raster.clear();
 
-        /**
-         * create start and end iterators of range to be removed. queue.begin()
-         * is equivalent to 1 therefore it_start -1 because we use 0 for the
-         * first pos all over the code.
-         */
-        std::deque<bool>::iterator it_start = queue.begin() + position;
-        std::deque<bool>::iterator it_end = it_start + nr_bits;
+    // same dummy pixels as the constructor sets
+    raster.set(width() - 1, height() - 1, ON[0]);
+    raster.set(width() - 2, height() - 1, OFF[0]);
 
-        // erase part of queue (automatically resizes queue)
-        queue.erase(it_start, it_end);
+    for (int row=0; gutter && row < height(); row++) {
+        forget(row);
     }
+
+    position = 0;
+    markDirty(0, height());
 }
+
+
 /**
- * @brief BinImg::flush displays a specified number of bits from the queue
- * @param nr_bits the number of bits taken from the front of the queue and being displayed
+ * @brief BinImg::detectStart detects start pattern
+ * @return position of left most pattern bit if detected otherwise -1
  */
-void
-BinImg::flush(int nr_bits) {
-    // display bits until nr_bits
-    for (int i=0; i < nr_bits; i++) {
-        set(queue.front());
+int
+BinImg::detectStart(int start_pos=0) {
+    return framer.detectStart(start_pos);
+}
 
-        // remove bit from queue
-        queue.pop_front();
-    }
+/**
+ * @brief BinImg::detectEnd detects end pattern
+ * @return position of right most pattern bit if detected otherwise -1
+ */
+int
+BinImg::detectEnd(int start_pos=0) {
+    return framer.detectEnd(start_pos);
+}
+
+/**
+ * @brief BinImg::detectStart detects start pattern in a packed buffer (8
+ * bits per byte, most significant bit first) such as a bit dump. The
+ * buffer is searched by the vectorized SyncSearch at all bit phases.
+ * @param buf packed bits
+ * @param nr_bits number of valid bits in buf
+ * @param start_pos position of the first bit a match may start at
+ * @return position of left most pattern bit if detected otherwise -1
+ */
+int64_t
+BinImg::detectStart(const unsigned char *buf, uint64_t nr_bits, uint64_t start_pos) const {
+    return framer.detectStart(buf, nr_bits, start_pos);
+}
+
+/**
+ * @brief BinImg::detectEnd detects end pattern in a packed buffer (8 bits
+ * per byte, most significant bit first) such as a bit dump. The buffer is
+ * searched by the vectorized SyncSearch at all bit phases.
+ * @param buf packed bits
+ * @param nr_bits number of valid bits in buf
+ * @param start_pos position of the first bit a match may start at
+ * @return position behind the right most pattern bit if detected otherwise -1
+ */
+int64_t
+BinImg::detectEnd(const unsigned char *buf, uint64_t nr_bits, uint64_t start_pos) const {
+    return framer.detectEnd(buf, nr_bits, start_pos);
 }
 
 /**
- * @brief BinImg::flush_partial flushes the queue but keeps keep_bits bits in the queue
- * @param keep_bits the number of tailing bits to be kept
+ * @brief BinImg::flush displays all queued and pending bits immediately and
+ * will result in an empty queue.
  */
 void
-BinImg::flushPartial(int keep_bits) {
+BinImg::flush() {
+
+    {
+        boost::mutex::scoped_lock lock(img_mutex, boost::defer_lock);
 
-    // keep end.length()-1 bits as these might match next time
-    while(queue.size() >= keep_bits) {
-        // set bit at position
-        set(queue.front());
+        if (!handoff) {
+            lock.lock();
+        }
 
-        // remove bit from queue
-        queue.pop_front();
+        framer.flush();
+        deliver();
     }
+
+    sync();
 }
 
 /**
- * @brief BinImg::check_pattern if it only consists of '1' and '0'
- * @param pattern to be checked
- * @return true if pattern is composed of '1' and '0' only
+ * @brief BinImg::sync places all bits handed over to the render thread
+ * right away instead of on its next frame, returns immediately without
+ * hand-off ring. Call it from the thread feeding the image.
  */
-bool
-BinImg::checkPattern(const std::string &pattern) {
+void
+BinImg::sync() {
+    if (!handoff) {
+        return;
+    }
 
-    // iterate through all characters of the pattern
-    for (int i=0; i < pattern.length(); i++) {
+    boost::mutex::scoped_lock lock(img_mutex);
 
-        // break loop if the character does not comply 0 or 1
-        if (pattern[i] != '0' && pattern[i] != '1') {
-            return false;
-        }
+    while (!handoff->empty()) {
+        drain();
     }
+}
 
-    return true;
+/**
+ * @brief BinImg::dropped
+ * @return the number of hand-off ring entries (up to HandoffRing::CHUNK_BITS
+ * bits or an event each) dropped on overflow so far, 0 without ring
+ */
+uint64_t
+BinImg::dropped() {
+    return handoff ? handoff->dropped() : 0;
 }
+
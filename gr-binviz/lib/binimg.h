@@ -1,55 +1,283 @@
 #ifndef BINIMG_H
 #define BINIMG_H
 
-#include <deque>
+#include <cstddef>
 #include <string>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
 #include "CImg.h"
+#include "bitqueue.h"
+#include "bitraster.h"
+#include "columnstats.h"
+#include "densitypyramid.h"
+#include "frameexporter.h"
+#include "framer.h"
+#include "handoffring.h"
+#include "packetindex.h"
+#include "scrollback.h"
 
-class BinImg: public cimg_library::CImg<unsigned char>
+class BinImg
 {
+    public:
+        /**
+         * @brief The Options struct holds the settings of an image other
+         * than its size, the defaults show a plain display without any
+         * framing, export or recording
+         */
+        struct Options
+        {
+            // marks start of a packet and puts new line before the pattern
+            // (e.g. '101010'), several start patterns are separated by
+            // commas (e.g. '101010,110011') and shade the lines they start
+            std::string start_pattern;
+
+            // marks end of packet and wraps to new line
+            std::string end_pattern;
+
+            // will kill all occurences of the pattern recoursively but will
+            // not apply if both, start and stop patterns are defined. The
+            // drop pattern have precedence over start and stop patterns.
+            std::string drop_pattern;
+
+            // ignore any byte composed of zeros, applies before drop, start
+            // and stop patterns
+            bool skip_zero_bytes;
+
+            // number of display refreshes (or dumps in headless mode) per
+            // second done by the render thread
+            double frame_rate;
+
+            // do not open a display, only maintain the image (no X server
+            // required)
+            bool headless;
+
+            // in headless mode the image is written to this file (PGM)
+            // whenever it changed, empty to disable
+            std::string dump_file;
+
+            // exported frames are written to numbered files named after
+            // this one (PNG if it ends with .png, PGM otherwise), empty to
+            // disable
+            std::string snapshot_file;
+
+            // exported frames are appended to this file or FIFO with 1 bit
+            // per pixel, empty to disable
+            std::string stream_file;
+
+            // frames are exported on each wrap from the bottom to the top
+            // of the image and additionally every export_interval seconds
+            // (if the image changed), 0 to export on wraps only
+            double export_interval;
+
+            // every displayed line is recorded to this file, the display
+            // can be scrolled back through all recorded lines, empty to
+            // disable
+            std::string scrollback_file;
+
+            // offset, length, time and scrollback line of every packet are
+            // recorded to this file if both, start and end pattern, are
+            // defined, empty to disable
+            std::string index_file;
+
+            // count the ones per column of all lines and show frequency and
+            // entropy per column in a second window
+            bool column_stats;
+
+            // display identical packets once and count the repeats in a
+            // gutter right of the image (start and end pattern defined)
+            bool dedup;
+
+            // number of bit errors tolerated in a start or end pattern
+            // match (less than half the pattern)
+            int start_errors;
+            int end_errors;
+
+            // lines (or packets) are started by markStart() and ended by
+            // markEnd(), e.g. on stream tags, instead of the start and end
+            // pattern
+            bool start_marks;
+            bool end_marks;
+
+            // bytes packed most or least significant bit first or unpacked
+            // bits (1 bit per byte, e.g. from a demodulator)
+            BitPacker::Format input_format;
+
+            // framed bits are handed over to the render thread by a
+            // lock-free ring of (at least) this many bits, it should hold
+            // the bits of a frame period. 0 to place bits right away
+            // (writers hold the image lock meanwhile).
+            size_t handoff_bits;
+
+            // what writers do once the hand-off ring is full: place the
+            // bits in the ring themselves under the image lock (BLOCK),
+            // drop the oldest bits (DROP_OLDEST) or drop every other line
+            // and the newest bits (DECIMATE)
+            HandoffRing::Overflow overflow;
+
+            Options();
+        };
+
     private:
         // colors of pixels
         static const unsigned char ON[];
         static const unsigned char OFF[];
         static const unsigned char CLEAR[];
 
+        // on shades of lines starting with the first, second, ... start
+        // pattern (all brighter than CLEAR, thus exported as on)
+        static const unsigned char TAGGED[][1];
+        static const int NR_TAGGED;
+
         static const bool REDRAW;
         static const char TITLE[];
+        static const double DEFAULT_FRAME_RATE;
+        static const char STATS_TITLE[];
+        static const int STATS_HEIGHT;
+        static const int GUTTER;
+
+        // the dots drawn, expanded to 8 bit gray only when shown or
+        // written (line and expanded are reused for that)
+        BitRaster raster;
+        std::vector<unsigned char> line;
+        cimg_library::CImg<unsigned char> expanded;
 
         // remember cursor position and size
         int position;
         int resize;
+
+        // zoomed out by 2^lod (0 if not) below one pixel per dot (resize
+        // 1), pixels show the density of ones of the pyramid (created on
+        // the first zoom out)
+        int lod;
+        boost::scoped_ptr<DensityPyramid> pyramid;
+
+        // start pattern of the current line, selects the on shade
+        int tag;
         cimg_library::CImgDisplay disp;
         bool disp_info;
-        bool in_packet;
 
-        // used as a bit queue ... so we can detect starts or ends
-        std::deque<bool> queue;
+        // the render thread pushes the image to disp at frame_rate, writers
+        // and the render thread synchronize on img_mutex
+        double frame_rate;
+        boost::mutex img_mutex;
+        boost::scoped_ptr<boost::thread> render_thread;
+
+        // time the render thread spent on frames (not sleeping) in seconds
+        uint64_t nr_frames;
+        double frame_time;
+        double max_frame_time;
+
+        // rows changed since the last upload [dirty_top, dirty_bottom) and
+        // the image scaled by resize, only changed rows are scaled again.
+        // The render thread uploads zoomed after releasing img_mutex.
+        int dirty_top;
+        int dirty_bottom;
+        cimg_library::CImg<unsigned char> zoomed;
+        bool upload;
+
+        // without display the image is written to dump_file if dirty
+        bool headless;
+        bool dirty;
+        std::string dump_file;
+
+        // frames are exported on each full image wrap and (if not zero)
+        // every export_interval seconds if the image changed meanwhile
+        boost::scoped_ptr<FrameExporter> exporter;
+        double export_interval;
+        bool export_dirty;
+
+        // lines are recorded as the cursor leaves them, the display can
+        // show recorded lines starting at history_top instead of the image
+        boost::scoped_ptr<Scrollback> scrollback;
+        bool in_history;
+        uint64_t history_top;
+        cimg_library::CImg<unsigned char> history;
+
+        // packets framed by start and end patterns are indexed, packet is
+        // the open packet (if packet_open)
+        boost::scoped_ptr<PacketIndex> packet_index;
+        PacketRecord packet;
+        bool packet_open;
+
+        // ones per column over all lines, shown as heatmap in a window of
+        // its own (ones frequency on top, entropy below) if stats_dirty
+        boost::scoped_ptr<ColumnStats> column_stats;
+        cimg_library::CImgDisplay stats_disp;
+        cimg_library::CImg<unsigned char> stats_img;
+        bool stats_dirty;
+        bool stats_upload;
 
-        // used to detect start and end sequences (wrap to new line)
-        std::string start;
-        std::string end;
-        std::string drop;
+        // identical packets are displayed once, repeats are counted and
+        // shown in a gutter right of the image (display only, 0 if off).
+        // seen maps the hash of each packet displayed to its row.
+        int gutter;
+        std::vector<uint64_t> row_hash;
+        std::vector<uint32_t> row_repeats;
+        boost::unordered_map<uint64_t, int> seen;
+        int packet_row;
+        uint64_t packet_hash;
+
+        // bits are skipped up to the next wrap (behind a repeated packet)
+        bool skipping;
+
+        // turns the byte stream into lines, start, end and drop patterns
+        // are handled there
+        Framer framer;
+
+        // framed bits are handed over to the render thread by the ring
+        // (if any) without img_mutex, the render thread drains it into
+        // handed once per frame. Without ring writers place them.
+        boost::scoped_ptr<HandoffRing> handoff;
+        BitQueue handed;
+        std::vector<FrameEvent> handed_events;
 
-        int detectPattern(const std::string &pattern, int start_pos = 0);
         int getMaxPixels();
         int getMaxPosition();
         void incPosition();
         int curPosition();
         int nextPosition();
         int wrapPosition();
+        void render();
+        void dump();
+        static bool writeRaster(const BitRaster &raster, const std::string &file);
+        void exportFrame();
+        void record(int row, int nr_pixels);
+        void browse(unsigned int key);
+        void drawHistory();
+        void drawStats();
+        void indexPacket(const FrameEvent &event);
+        bool repeat(const FrameEvent &event);
+        void remember();
+        void forget(int row);
+        void drawGutter(unsigned char *row, int y);
+        void deliver();
+        void drain();
+        void place(const BitQueue &bits, const std::vector<FrameEvent> &events);
+        void place(const FrameEvent &event);
         void update();
         void refresh();
-        void remove(int nr_bits, int position = 0);
-        void flush(int nr_bits);
-        void flushPartial(int keep_bits);
-        bool checkPattern(const std::string &pattern);
-        void clear(int position);
+        int zoomWidth();
+        int zoomHeight();
+        void zoom();
+        void markDirty(int top, int bottom);
+        void draw(int position, const unsigned char color[]);
+        void put(bool state);
+        void putBits(const BitQueue &bits, size_t first, size_t nr_bits);
 
     public:
-        BinImg(int width, int height, const std::string &start_pattern = "", const std::string &end_pattern = "", const std::string &drop_pattern = "");
+        BinImg(int width, int height, const Options &options = Options());
+        ~BinImg();
+
+        int width() const;
+        int height() const;
 
         void consume(const unsigned char in_byte);
+        void consume(const unsigned char *in, size_t len);
+        void markStart();
+        void markEnd();
 
         void on(int x, int y);
         void on(int position);
@@ -59,13 +287,36 @@ class BinImg: public cimg_library::CImg<unsigned char>
         void set(int x, int y, const unsigned char color[]);
         void set(int position, const unsigned char color[]);
 
+        unsigned char getPixel(int x, int y);
+        int getPosition();
+
         void setStart(const char detect_start[]);
         void setEnd(const char detect_end[]);
         int detectStart(int start_pos);
         int detectEnd(int start_pos);
+        int64_t detectStart(const unsigned char *buf, uint64_t nr_bits, uint64_t start_pos = 0) const;
+        int64_t detectEnd(const unsigned char *buf, uint64_t nr_bits, uint64_t start_pos = 0) const;
+
+        uint64_t packets();
+        int64_t fetchPacket(uint64_t nr, std::vector<unsigned char> &bits);
+        void showPacket(uint64_t nr);
+
+        void fetchColumnStats(std::vector<double> &frequency, std::vector<double> &entropy);
+        void fetchFrameTimes(uint64_t &nr_frames, double &mean, double &max);
+        uint32_t repeats(int row);
+
+        void putLine(const BitQueue &bits);
+
+        uint64_t dropped();
+
+        void clear();
+        bool save(const std::string &file);
 
         void wait();
+        unsigned int key();
+        bool closed();
         void flush();
+        void sync();
 };
 
 #endif // BINIMG_H
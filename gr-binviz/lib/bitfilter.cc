@@ -0,0 +1,190 @@
+#include "bitfilter.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief findByte finds the next byte that is (or is not) zero
+ * @param in pointer to the bytes
+ * @param pos of the first byte to be checked
+ * @param len number of bytes
+ * @param zero true to find the next zero byte, false to find the next
+ * non-zero byte
+ * @return position of the byte found or len if there is none
+ */
+static size_t
+findByte(const unsigned char *in, size_t pos, size_t len, bool zero)
+{
+#ifdef __SSE2__
+    const __m128i zeros = _mm_setzero_si128();
+
+    // bit k of the mask is set if byte k is zero
+    for (; pos + 16 <= len; pos += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (in + pos));
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zeros));
+
+        if (!zero) {
+            mask ^= 0xffff;
+        }
+
+        if (mask) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    for (; pos < len; pos++) {
+        if ((in[pos] == 0) == zero) {
+            return pos;
+        }
+    }
+
+    return len;
+}
+
+/**
+ * @brief BitFilter::BitFilter
+ * @param drop_pattern composed of '0' and '1' only (check before), all
+ * occurences are removed recursively, empty to not drop anything
+ * @param skip_zero_bytes ignore any byte composed of zeros, applies before
+ * the drop pattern
+ */
+BitFilter::BitFilter(const std::string &drop_pattern, bool skip_zero_bytes)
+    :skip_zero_bytes(skip_zero_bytes), drop_matcher(drop_pattern)
+{
+}
+
+/**
+ * @brief BitFilter::empty
+ * @return true if the filter passes all bits as they are
+ */
+bool
+BitFilter::empty() const
+{
+    return !skip_zero_bytes && drop_matcher.empty();
+}
+
+/**
+ * @brief BitFilter::push cleans a buffer of bytes. Bits that can not be
+ * part of a drop pattern anymore are appended to out, the last bits of
+ * the drop pattern length - 1 are kept until the next call (or flush()).
+ * @param in pointer to the first byte, most significant bit first
+ * @param len number of bytes
+ * @param out the cleaned bits are appended to
+ */
+void
+BitFilter::push(const unsigned char *in, size_t len, BitQueue &out)
+{
+    if (!skip_zero_bytes) {
+        pass(in, len, out);
+
+        return;
+    }
+
+    // ignorance of zero bytes has precedence over the drop pattern, only
+    // runs of non-zero bytes are passed on
+    size_t pos = findByte(in, 0, len, false);
+
+    while (pos < len) {
+        size_t zero = findByte(in, pos, len, true);
+
+        pass(in + pos, zero - pos, out);
+        pos = findByte(in, zero, len, false);
+    }
+}
+
+/**
+ * @brief BitFilter::pass removes drop pattern occurences from a run of
+ * bytes
+ * @param in pointer to the first byte of the run
+ * @param len number of bytes of the run
+ * @param out the cleaned bits are appended to
+ */
+void
+BitFilter::pass(const unsigned char *in, size_t len, BitQueue &out)
+{
+    if (drop_matcher.empty()) {
+        out.push_bytes(in, len);
+
+        return;
+    }
+
+    size_t keep_bits = drop_matcher.length() - 1;
+
+    for (size_t i=0; i < len; i++) {
+        for (int j=7; j >= 0; j--) {
+            filter((in[i] >> j) & 1);
+        }
+
+        // keep drop.length()-1 bits as these might match next time, all
+        // bits before can't be dropped anymore and are passed on
+        if (pending.size() > keep_bits) {
+            release(pending.size() - keep_bits, out);
+        }
+    }
+}
+
+/**
+ * @brief BitFilter::push_bits filters single bits (e.g. of an incomplete
+ * byte), they are never skipped as zero byte and kept until flush()
+ * @param bits left aligned, the first bit is the most significant bit
+ * @param nr_bits number of bits (0 to 64)
+ */
+void
+BitFilter::push_bits(uint64_t bits, int nr_bits)
+{
+    for (int i=0; i < nr_bits; i++) {
+        filter((bits >> (63 - i)) & 1);
+    }
+}
+
+/**
+ * @brief BitFilter::filter appends a bit to the pending bits and drops the
+ * drop pattern as soon as it is completed by the bit. Removal may expose
+ * a new occurence with older pending bits, which is removed once the bit
+ * completing it arrives (equivalent to removing the left most occurence
+ * until none is left).
+ * @param bit the next bit of the stream
+ */
+void
+BitFilter::filter(bool bit)
+{
+    pending.push_back(bit);
+
+    if (drop_matcher.push(bit)) {
+        pending.pop_back(drop_matcher.length());
+
+        // the window has to reflect the bits in front of the removed ones
+        drop_matcher.prime(pending);
+    }
+}
+
+/**
+ * @brief BitFilter::release passes pending bits on, 64 bits at a time
+ * @param nr_bits the number of bits taken from the front of the pending bits
+ * @param out the bits are appended to
+ */
+void
+BitFilter::release(size_t nr_bits, BitQueue &out)
+{
+    for (size_t i=0; i < nr_bits; i += 64) {
+        int nr_word_bits = nr_bits - i < 64 ? nr_bits - i : 64;
+
+        out.push_bits(pending.word(i), nr_word_bits);
+    }
+
+    pending.pop_front(nr_bits);
+}
+
+/**
+ * @brief BitFilter::flush passes all pending bits on, they are not part
+ * of any later match
+ * @param out the bits are appended to
+ */
+void
+BitFilter::flush(BitQueue &out)
+{
+    release(pending.size(), out);
+    drop_matcher.reset();
+}
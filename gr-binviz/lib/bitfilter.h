@@ -0,0 +1,40 @@
+#ifndef BITFILTER_H
+#define BITFILTER_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include "bitqueue.h"
+#include "patternmatcher.h"
+
+/**
+ * @brief The BitFilter class cleans a byte stream before framing: zero
+ * bytes are skipped and drop pattern occurences are removed in a single
+ * pass. Runs of zero and non-zero bytes are found 16 bytes at a time
+ * (SSE2), non-zero runs are appended 64 bits at a time unless a drop
+ * pattern has to be tracked bit by bit by its sliding window matcher.
+ */
+class BitFilter
+{
+    private:
+        bool skip_zero_bytes;
+
+        // bits that might still be part of a drop pattern
+        PatternMatcher drop_matcher;
+        BitQueue pending;
+
+        void filter(bool bit);
+        void release(size_t nr_bits, BitQueue &out);
+        void pass(const unsigned char *in, size_t len, BitQueue &out);
+
+    public:
+        BitFilter(const std::string &drop_pattern = "", bool skip_zero_bytes = false);
+
+        bool empty() const;
+
+        void push(const unsigned char *in, size_t len, BitQueue &out);
+        void push_bits(uint64_t bits, int nr_bits);
+        void flush(BitQueue &out);
+};
+
+#endif // BITFILTER_H
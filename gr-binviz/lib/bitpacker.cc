@@ -0,0 +1,247 @@
+#include "bitpacker.h"
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief loadNative reads 8 bytes in host byte order
+ */
+static inline uint64_t
+loadNative(const unsigned char *in)
+{
+    uint64_t word;
+
+    memcpy(&word, in, sizeof(word));
+
+    return word;
+}
+
+/**
+ * @brief loadMSB reads 8 bytes, the first one as most significant byte
+ */
+static inline uint64_t
+loadMSB(const unsigned char *in)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_bswap64(loadNative(in));
+#else
+    return loadNative(in);
+#endif
+}
+
+/**
+ * @brief loadLSB reads 8 bytes, the first one as least significant byte
+ */
+static inline uint64_t
+loadLSB(const unsigned char *in)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return loadNative(in);
+#else
+    return __builtin_bswap64(loadNative(in));
+#endif
+}
+
+/**
+ * @brief mirrorBytes reverses the order of the bits within every byte
+ */
+static inline uint64_t
+mirrorBytes(uint64_t word)
+{
+    word = ((word >> 1) & 0x5555555555555555ULL) | ((word & 0x5555555555555555ULL) << 1);
+    word = ((word >> 2) & 0x3333333333333333ULL) | ((word & 0x3333333333333333ULL) << 2);
+    word = ((word >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((word & 0x0f0f0f0f0f0f0f0fULL) << 4);
+
+    return word;
+}
+
+/**
+ * @brief packByte packs 8 unpacked bits, the lowest bit of byte i is moved
+ * to bit 63-i by the multiply (no two partial products overlap)
+ * @return the bits, the first one as most significant bit
+ */
+static inline unsigned char
+packByte(const unsigned char *in)
+{
+    return ((loadLSB(in) & 0x0101010101010101ULL) * 0x8040201008040201ULL) >> 56;
+}
+
+/**
+ * @brief packWord packs 64 unpacked bits
+ * @return the bits, the first one as most significant bit
+ */
+static inline uint64_t
+packWord(const unsigned char *in)
+{
+#ifdef __SSE2__
+    uint64_t mask = 0;
+
+    // the lowest bit of each byte is shifted into its sign bit, bit k of
+    // mask is byte k then
+    for (int i=0; i < 4; i++) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (in + 16 * i));
+
+        mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_slli_epi64(bytes, 7)) << (16 * i);
+    }
+
+    return mirrorBytes(__builtin_bswap64(mask));
+#else
+    uint64_t word = 0;
+
+    for (int i=0; i < 8; i++) {
+        word = (word << 8) | packByte(in + 8 * i);
+    }
+
+    return word;
+#endif
+}
+
+/**
+ * @brief BitPacker::BitPacker
+ * @param format of the input
+ */
+BitPacker::BitPacker(Format format)
+    :format(format), partial(0), nr_partial(0)
+{
+}
+
+/**
+ * @brief BitPacker::getFormat
+ * @return the format of the input
+ */
+BitPacker::Format
+BitPacker::getFormat() const
+{
+    return format;
+}
+
+/**
+ * @brief BitPacker::pack appends the bits of the input to a bit queue 64
+ * bits at a time, unpacked input of any length is appended completely
+ * @param in pointer to the first byte of the input
+ * @param len number of input bytes
+ * @param out the bits are appended to
+ * @return the number of bits appended
+ */
+uint64_t
+BitPacker::pack(const unsigned char *in, size_t len, BitQueue &out)
+{
+    size_t i = 0;
+
+    if (format == UNPACKED) {
+        for (; i + 64 <= len; i += 64) {
+            out.push_bits(packWord(in + i), 64);
+        }
+
+        uint64_t word = 0;
+
+        for (size_t j=i; j < len; j++) {
+            word |= (uint64_t) (in[j] & 1) << (63 - (j - i));
+        }
+
+        if (len > i) {
+            out.push_bits(word, len - i);
+        }
+
+        return len;
+    }
+
+    if (format == PACKED_MSB) {
+        out.push_bytes(in, len);
+
+        return 8 * (uint64_t) len;
+    }
+
+    for (; i + 8 <= len; i += 8) {
+        out.push_bits(mirrorBytes(loadMSB(in + i)), 64);
+    }
+
+    for (; i < len; i++) {
+        out.push_byte(mirrorBytes(in[i]));
+    }
+
+    return 8 * (uint64_t) len;
+}
+
+/**
+ * @brief BitPacker::pack converts the input into packed bytes, most
+ * significant bit first. Unpacked bits of an incomplete byte are kept for
+ * the next call (see takePartial()).
+ * @param in pointer to the first byte of the input
+ * @param len number of input bytes
+ * @param out receives the packed bytes
+ */
+void
+BitPacker::pack(const unsigned char *in, size_t len, std::vector<unsigned char> &out)
+{
+    size_t i = 0;
+
+    out.clear();
+
+    if (format != UNPACKED) {
+        out.assign(in, in + len);
+
+        // the order of the bytes does not matter here
+        for (; format == PACKED_LSB && i + 8 <= len; i += 8) {
+            uint64_t word = mirrorBytes(loadNative(in + i));
+
+            memcpy(&out[i], &word, sizeof(word));
+        }
+
+        for (; format == PACKED_LSB && i < len; i++) {
+            out[i] = mirrorBytes(in[i]);
+        }
+
+        return;
+    }
+
+    out.reserve((nr_partial + len) / 8);
+
+    // complete the byte left over by the last call
+    for (; nr_partial && i < len; i++) {
+        partial = (partial << 1) | (in[i] & 1);
+
+        if (++nr_partial == 8) {
+            out.push_back(partial);
+            partial = 0;
+            nr_partial = 0;
+        }
+    }
+
+    for (; i + 64 <= len; i += 64) {
+        uint64_t word = packWord(in + i);
+
+        for (int j=56; j >= 0; j -= 8) {
+            out.push_back(word >> j);
+        }
+    }
+
+    for (; i + 8 <= len; i += 8) {
+        out.push_back(packByte(in + i));
+    }
+
+    for (; i < len; i++) {
+        partial = (partial << 1) | (in[i] & 1);
+        nr_partial++;
+    }
+}
+
+/**
+ * @brief BitPacker::takePartial hands out the unpacked bits of an
+ * incomplete byte, e.g. on flush
+ * @param bits receives the bits, the last one as lowest bit
+ * @return the number of bits (0 to 7)
+ */
+int
+BitPacker::takePartial(unsigned char &bits)
+{
+    int nr_bits = nr_partial;
+
+    bits = partial;
+    partial = 0;
+    nr_partial = 0;
+
+    return nr_bits;
+}
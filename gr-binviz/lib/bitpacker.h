@@ -0,0 +1,45 @@
+#ifndef BITPACKER_H
+#define BITPACKER_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include "bitqueue.h"
+
+/**
+ * @brief The BitPacker class converts the input of a sink into packed bits
+ * (8 bits per byte, most significant bit first) as framed and displayed.
+ * Input is either packed most or least significant bit first or unpacked
+ * (1 bit per byte in its lowest bit, e.g. the output of a demodulator).
+ *
+ * Unpacked input is packed 64 bits at a time, 16 bytes per SSE2 movemask
+ * (a multiply per 8 bytes without SSE2), and may be appended straight to
+ * a BitQueue without any intermediate buffer.
+ */
+class BitPacker
+{
+    public:
+        enum Format {
+            PACKED_MSB,
+            PACKED_LSB,
+            UNPACKED
+        };
+
+    private:
+        Format format;
+
+        // unpacked bits in front of the next byte, lowest bit last
+        unsigned char partial;
+        int nr_partial;
+
+    public:
+        BitPacker(Format format = PACKED_MSB);
+
+        Format getFormat() const;
+
+        uint64_t pack(const unsigned char *in, size_t len, BitQueue &out);
+        void pack(const unsigned char *in, size_t len, std::vector<unsigned char> &out);
+        int takePartial(unsigned char &bits);
+};
+
+#endif // BITPACKER_H
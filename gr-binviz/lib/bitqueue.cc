@@ -0,0 +1,321 @@
+#include "bitqueue.h"
+#include <cstring>
+
+/**
+ * @brief BitQueue::BitQueue creates an empty queue with room for 64 bits,
+ * the storage doubles whenever it runs full
+ */
+BitQueue::BitQueue()
+    :words(1, 0), head(0), count(0), mask(63)
+{
+}
+
+/**
+ * @brief BitQueue::size
+ * @return the number of queued bits
+ */
+size_t
+BitQueue::size() const
+{
+    return count;
+}
+
+/**
+ * @brief BitQueue::empty
+ * @return true if no bits are queued
+ */
+bool
+BitQueue::empty() const
+{
+    return count == 0;
+}
+
+/**
+ * @brief BitQueue::clear drops all queued bits but keeps the storage
+ */
+void
+BitQueue::clear()
+{
+    head = 0;
+    count = 0;
+}
+
+/**
+ * @brief BitQueue::front
+ * @return the oldest queued bit
+ */
+bool
+BitQueue::front() const
+{
+    return at(0);
+}
+
+/**
+ * @brief BitQueue::at random access to a queued bit
+ * @param pos of the bit (0 is the front of the queue)
+ * @return the bit at pos
+ */
+bool
+BitQueue::at(size_t pos) const
+{
+    size_t ring_pos = (head + pos) & mask;
+
+    return (words[ring_pos >> 6] >> (63 - (ring_pos & 63))) & 1;
+}
+
+/**
+ * @brief BitQueue::word reads 64 consecutive bits
+ * @param pos of the first bit to be read (0 is the front of the queue)
+ * @return the bit at pos as most significant bit followed by the next 63
+ * bits, positions past the end of the queue read as 0
+ */
+uint64_t
+BitQueue::word(size_t pos) const
+{
+    if (pos >= count) {
+        return 0;
+    }
+
+    size_t ring_pos = (head + pos) & mask;
+    size_t index = ring_pos >> 6;
+    int offset = ring_pos & 63;
+
+    uint64_t bits = words[index] << offset;
+
+    // the remaining bits come from the next word of the ring
+    if (offset) {
+        bits |= words[(index + 1) & (words.size() - 1)] >> (64 - offset);
+    }
+
+    // hide bits beyond the end of the queue
+    size_t available = count - pos;
+
+    if (available < 64) {
+        bits &= ~(~0ULL >> available);
+    }
+
+    return bits;
+}
+
+/**
+ * @brief BitQueue::write overwrites up to 64 bits, the caller has to make
+ * sure the storage is large enough
+ * @param pos of the first bit to be written (0 is the front of the queue)
+ * @param bits the bits to be written, most significant bit first
+ * @param nr_bits the number of bits taken from the top of bits (1 - 64)
+ */
+void
+BitQueue::write(size_t pos, uint64_t bits, int nr_bits)
+{
+    size_t ring_pos = (head + pos) & mask;
+    size_t index = ring_pos >> 6;
+    int offset = ring_pos & 63;
+
+    uint64_t bit_mask = nr_bits >= 64 ? ~0ULL : ~(~0ULL >> nr_bits);
+
+    bits &= bit_mask;
+    words[index] = (words[index] & ~(bit_mask >> offset)) | (bits >> offset);
+
+    // spill over into the next word of the ring
+    if (offset + nr_bits > 64) {
+        size_t next = (index + 1) & (words.size() - 1);
+        int shift = 64 - offset;
+
+        words[next] = (words[next] & ~(bit_mask << shift)) | (bits << shift);
+    }
+}
+
+/**
+ * @brief BitQueue::grow doubles the storage until it holds min_bits and
+ * rearranges the queued bits to start at the first word
+ * @param min_bits the minimum capacity in bits
+ */
+void
+BitQueue::grow(size_t min_bits)
+{
+    size_t capacity = words.size() * 64;
+
+    while (capacity < min_bits) {
+        capacity *= 2;
+    }
+
+    std::vector<uint64_t> grown(capacity / 64, 0);
+
+    for (size_t pos = 0; pos < count; pos += 64) {
+        grown[pos >> 6] = word(pos);
+    }
+
+    words.swap(grown);
+    head = 0;
+    mask = capacity - 1;
+}
+
+/**
+ * @brief BitQueue::push_back appends a single bit
+ * @param bit to be appended
+ */
+void
+BitQueue::push_back(bool bit)
+{
+    if (count == mask + 1) {
+        grow(count + 1);
+    }
+
+    write(count, bit ? (1ULL << 63) : 0, 1);
+    count++;
+}
+
+/**
+ * @brief BitQueue::push_byte appends 8 bits, most significant bit first
+ * @param byte to be appended
+ */
+void
+BitQueue::push_byte(unsigned char byte)
+{
+    if (count + 8 > mask + 1) {
+        grow(count + 8);
+    }
+
+    write(count, (uint64_t) byte << 56, 8);
+    count += 8;
+}
+
+/**
+ * @brief BitQueue::push_bits appends up to 64 bits at once
+ * @param bits left aligned like word() returns them, the first bit is the
+ * most significant bit
+ * @param nr_bits the number of bits to be appended (1 to 64)
+ */
+void
+BitQueue::push_bits(uint64_t bits, int nr_bits)
+{
+    if (count + nr_bits > mask + 1) {
+        grow(count + nr_bits);
+    }
+
+    write(count, bits, nr_bits);
+    count += nr_bits;
+}
+
+/**
+ * @brief BitQueue::push_bytes appends bytes 64 bits at a time, most
+ * significant bit of each byte first
+ * @param bytes pointer to the first byte to be appended
+ * @param len number of bytes
+ */
+void
+BitQueue::push_bytes(const unsigned char *bytes, size_t len)
+{
+    if (count + 8 * len > mask + 1) {
+        grow(count + 8 * len);
+    }
+
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t bits;
+
+        memcpy(&bits, bytes + i, sizeof(bits));
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        bits = __builtin_bswap64(bits);
+#endif
+
+        write(count, bits, 64);
+        count += 64;
+    }
+
+    for (; i < len; i++) {
+        write(count, (uint64_t) bytes[i] << 56, 8);
+        count += 8;
+    }
+}
+
+/**
+ * @brief BitQueue::append appends all bits of another queue 64 bits at a
+ * time
+ * @param bits the queue to be appended
+ */
+void
+BitQueue::append(const BitQueue &bits)
+{
+    if (count + bits.size() > mask + 1) {
+        grow(count + bits.size());
+    }
+
+    for (size_t i=0; i < bits.size(); i += 64) {
+        int nr_bits = bits.size() - i < 64 ? bits.size() - i : 64;
+
+        write(count, bits.word(i), nr_bits);
+        count += nr_bits;
+    }
+}
+
+/**
+ * @brief BitQueue::pop_front drops bits from the front in O(1)
+ * @param nr_bits the number of bits to be dropped
+ */
+void
+BitQueue::pop_front(size_t nr_bits)
+{
+    if (nr_bits > count) {
+        nr_bits = count;
+    }
+
+    head = (head + nr_bits) & mask;
+    count -= nr_bits;
+}
+
+/**
+ * @brief BitQueue::pop_back drops the newest bits in O(1)
+ * @param nr_bits the number of bits to be dropped
+ */
+void
+BitQueue::pop_back(size_t nr_bits)
+{
+    if (nr_bits > count) {
+        nr_bits = count;
+    }
+
+    count -= nr_bits;
+}
+
+/**
+ * @brief BitQueue::erase removes bits from the middle of the queue. The
+ * shorter side of the queue is moved word by word to close the gap.
+ * @param pos of the first bit to be removed (0 is the front of the queue)
+ * @param nr_bits the number of bits to be removed
+ */
+void
+BitQueue::erase(size_t pos, size_t nr_bits)
+{
+    if (nr_bits == 0 || pos + nr_bits > count) {
+        return;
+    }
+
+    if (pos < count - pos - nr_bits) {
+
+        // move the bits in front of the gap towards the back, the last
+        // chunk first so that no unread bit gets overwritten
+        for (size_t i = pos; i > 0; ) {
+            int chunk = i >= 64 ? 64 : i;
+
+            i -= chunk;
+            write(i + nr_bits, word(i), chunk);
+        }
+
+        head = (head + nr_bits) & mask;
+    }
+    else {
+
+        // move the bits behind the gap towards the front
+        for (size_t i = pos + nr_bits; i < count; ) {
+            int chunk = count - i >= 64 ? 64 : count - i;
+
+            write(i - nr_bits, word(i), chunk);
+            i += chunk;
+        }
+    }
+
+    count -= nr_bits;
+}
@@ -0,0 +1,50 @@
+#ifndef BITQUEUE_H
+#define BITQUEUE_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief The BitQueue class is a ring buffer of bits packed into 64 bit
+ * words. Bits are stored in stream order, the first bit of a word being
+ * its most significant bit. Popping bits from the front is O(1), reads of
+ * up to 64 consecutive bits cost two word accesses.
+ */
+class BitQueue
+{
+    private:
+        // ring storage, the number of words is always a power of two
+        std::vector<uint64_t> words;
+
+        // ring index of the front bit, number of queued bits and ring
+        // capacity in bits minus one (used as modulo mask)
+        size_t head;
+        size_t count;
+        size_t mask;
+
+        void grow(size_t min_bits);
+        void write(size_t pos, uint64_t bits, int nr_bits);
+
+    public:
+        BitQueue();
+
+        size_t size() const;
+        bool empty() const;
+        void clear();
+
+        bool front() const;
+        bool at(size_t pos) const;
+        uint64_t word(size_t pos) const;
+
+        void push_back(bool bit);
+        void push_byte(unsigned char byte);
+        void push_bits(uint64_t bits, int nr_bits);
+        void push_bytes(const unsigned char *bytes, size_t len);
+        void append(const BitQueue &bits);
+        void pop_front(size_t nr_bits = 1);
+        void pop_back(size_t nr_bits = 1);
+        void erase(size_t pos, size_t nr_bits);
+};
+
+#endif // BITQUEUE_H
@@ -0,0 +1,281 @@
+#include "bitraster.h"
+#include <algorithm>
+#include <cstring>
+
+const unsigned char BitRaster::OFF = 0;
+const unsigned char BitRaster::CLEAR = 128;
+
+/**
+ * @brief The ExpandTable struct maps 8 dots (a byte, first dot most
+ * significant) to 8 pixel bytes, 0xff where the dot is set. The bytes are
+ * in memory order, a mask selects 8 pixels of a row with a single word
+ * operation.
+ */
+static struct ExpandTable
+{
+    uint64_t masks[256];
+
+    ExpandTable()
+    {
+        for (int byte=0; byte < 256; byte++) {
+            unsigned char pixels[8];
+
+            for (int k=0; k < 8; k++) {
+                pixels[k] = (byte & (0x80 >> k)) ? 0xff : 0;
+            }
+
+            memcpy(&masks[byte], pixels, 8);
+        }
+    }
+} expand_table;
+
+/**
+ * @brief broadcast
+ * @return the word with each byte set to value
+ */
+static inline uint64_t
+broadcast(unsigned char value)
+{
+    return value * 0x0101010101010101ULL;
+}
+
+/**
+ * @brief BitRaster::BitRaster creates a raster of cleared dots
+ * @param width the number of dots per row
+ * @param height the number of rows
+ */
+BitRaster::BitRaster(int width, int height)
+    :nr_columns(width), nr_rows(height), nr_words((width + 63) / 64), values(nr_words * height), drawn(nr_words * height), shades(height, 255)
+{
+}
+
+/**
+ * @brief BitRaster::width
+ * @return the number of dots per row
+ */
+int
+BitRaster::width() const
+{
+    return nr_columns;
+}
+
+/**
+ * @brief BitRaster::height
+ * @return the number of rows
+ */
+int
+BitRaster::height() const
+{
+    return nr_rows;
+}
+
+/**
+ * @brief BitRaster::clear all dots (gray)
+ */
+void
+BitRaster::clear()
+{
+    std::fill(drawn.begin(), drawn.end(), 0);
+}
+
+/**
+ * @brief BitRaster::set a dot, dots outside the raster are ignored
+ * @param x the x-coordinate of the dot
+ * @param y the y-coordinate of the dot
+ * @param color gray shade of the dot: CLEAR clears it, brighter shades set
+ * it on (and shade all on dots of the row), darker shades set it off
+ */
+void
+BitRaster::set(int x, int y, unsigned char color)
+{
+    if (x < 0 || x >= nr_columns || y < 0 || y >= nr_rows) {
+        return;
+    }
+
+    size_t word = y * nr_words + x / 64;
+    uint64_t bit = 0x8000000000000000ULL >> (x % 64);
+
+    if (color == CLEAR) {
+        drawn[word] &= ~bit;
+
+        return;
+    }
+
+    drawn[word] |= bit;
+
+    if (color > CLEAR) {
+        values[word] |= bit;
+        shades[y] = color;
+    }
+    else {
+        values[word] &= ~bit;
+    }
+}
+
+/**
+ * @brief BitRaster::get a dot
+ * @param x the x-coordinate of the dot
+ * @param y the y-coordinate of the dot
+ * @return the gray shade of the dot: the shade of the row if on, OFF or
+ * CLEAR (also outside the raster)
+ */
+unsigned char
+BitRaster::get(int x, int y) const
+{
+    if (x < 0 || x >= nr_columns || y < 0 || y >= nr_rows) {
+        return CLEAR;
+    }
+
+    size_t word = y * nr_words + x / 64;
+    uint64_t bit = 0x8000000000000000ULL >> (x % 64);
+
+    if (!(drawn[word] & bit)) {
+        return CLEAR;
+    }
+
+    return (values[word] & bit) ? shades[y] : OFF;
+}
+
+/**
+ * @brief BitRaster::valueRow
+ * @param y the row
+ * @return the value bits of the row packed into words (see drawnRow(),
+ * values of dots not drawn are meaningless)
+ */
+const uint64_t *
+BitRaster::valueRow(int y) const
+{
+    return &values[y * nr_words];
+}
+
+/**
+ * @brief BitRaster::drawnRow
+ * @param y the row
+ * @return the drawn bits of the row packed into words
+ */
+const uint64_t *
+BitRaster::drawnRow(int y) const
+{
+    return &drawn[y * nr_words];
+}
+
+/**
+ * @brief leading
+ * @return a word with the nr_bits (0 to 64) most significant bits set
+ */
+static inline uint64_t
+leading(int nr_bits)
+{
+    return nr_bits >= 64 ? ~0ULL : ~(~0ULL >> nr_bits);
+}
+
+/**
+ * @brief BitRaster::merge draws bits into a word of the raster
+ * @param word index of the word in values and drawn
+ * @param mask the dots to be drawn
+ * @param bits values of the dots (others are ignored)
+ */
+void
+BitRaster::merge(size_t word, uint64_t mask, uint64_t bits)
+{
+    values[word] = (values[word] & ~mask) | (bits & mask);
+    drawn[word] |= mask;
+}
+
+/**
+ * @brief BitRaster::write draws a span of bits onto a row, 64 dots at a
+ * time. The span has to fit the row.
+ * @param x the x-coordinate of the first dot
+ * @param y the row
+ * @param bits to be drawn (on or off)
+ * @param first position of the first bit in bits
+ * @param nr_dots number of bits drawn
+ * @param shade of the on dots, the row takes it
+ */
+void
+BitRaster::write(int x, int y, const BitQueue &bits, size_t first, int nr_dots, unsigned char shade)
+{
+    if (nr_dots <= 0) {
+        return;
+    }
+
+    size_t row = y * nr_words;
+
+    for (int i=0; i < nr_dots; i += 64) {
+        int nr_bits = std::min(nr_dots - i, 64);
+        uint64_t word = bits.word(first + i) & leading(nr_bits);
+        size_t index = row + (x + i) / 64;
+        int offset = (x + i) % 64;
+
+        merge(index, leading(nr_bits) >> offset, word >> offset);
+
+        // the bits spill over into the next word
+        if (offset + nr_bits > 64) {
+            merge(index + 1, leading(offset + nr_bits - 64), word << (64 - offset));
+        }
+    }
+
+    shades[y] = shade;
+}
+
+/**
+ * @brief BitRaster::clear a span of a row (gray), a word at a time. The
+ * span has to fit the row.
+ * @param x the x-coordinate of the first dot
+ * @param y the row
+ * @param nr_dots number of dots cleared
+ */
+void
+BitRaster::clear(int x, int y, int nr_dots)
+{
+    size_t row = y * nr_words;
+
+    while (nr_dots > 0) {
+        int offset = x % 64;
+        int nr_bits = std::min(nr_dots, 64 - offset);
+
+        drawn[row + x / 64] &= ~(leading(nr_bits) >> offset);
+
+        x += nr_bits;
+        nr_dots -= nr_bits;
+    }
+}
+
+/**
+ * @brief BitRaster::expand a row to 8 bit gray, 8 dots at a time. Value
+ * and drawn bits are looked up as masks and blended with a few word
+ * operations: on dots take the shade of the row, off dots are black and
+ * dots not drawn are gray.
+ * @param y the row
+ * @param pixels receives width() pixels
+ */
+void
+BitRaster::expand(int y, unsigned char *pixels) const
+{
+    const uint64_t *value = &values[y * nr_words];
+    const uint64_t *mask = &drawn[y * nr_words];
+    uint64_t shade = broadcast(shades[y]);
+    uint64_t clear = broadcast(CLEAR);
+
+    for (int x=0; x < nr_columns; x += 8) {
+        int shift = 56 - x % 64;
+        uint64_t on = expand_table.masks[(value[x / 64] >> shift) & 0xff];
+        uint64_t set = expand_table.masks[(mask[x / 64] >> shift) & 0xff];
+        uint64_t eight = (on & set & shade) | (~set & clear);
+
+        memcpy(pixels + x, &eight, std::min(nr_columns - x, 8));
+    }
+}
+
+/**
+ * @brief BitRaster::expand all rows to 8 bit gray (see expand(int, unsigned
+ * char *))
+ * @param pixels receives width() * height() pixels, row by row
+ */
+void
+BitRaster::expand(unsigned char *pixels) const
+{
+    for (int y=0; y < nr_rows; y++) {
+        expand(y, pixels + (size_t) y * nr_columns);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef BITRASTER_H
+#define BITRASTER_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include "bitqueue.h"
+
+/**
+ * @brief The BitRaster class holds the dots of the image packed, a bit per
+ * dot and a drawn mask of another bit per dot (cleared dots are gray).
+ * The on dots of a row share a gray shade (the lines of a start pattern
+ * are shaded alike). The raster takes a quarter of an 8 bit image, rows
+ * are expanded to 8 bit gray only to be shown or written, 8 dots at a
+ * time by lookup table.
+ *
+ * Rows are packed into 64 bit words, the first dot is the most
+ * significant bit (same as BitQueue). Spans of a row are written and
+ * cleared a word at a time.
+ */
+class BitRaster
+{
+    private:
+        static const unsigned char OFF;
+        static const unsigned char CLEAR;
+
+        int nr_columns;
+        int nr_rows;
+        size_t nr_words;
+
+        // value and drawn bits of all rows, nr_words per row. Values of
+        // dots not drawn are meaningless.
+        std::vector<uint64_t> values;
+        std::vector<uint64_t> drawn;
+
+        // the on shade of each row
+        std::vector<unsigned char> shades;
+
+        void merge(size_t word, uint64_t mask, uint64_t bits);
+
+    public:
+        BitRaster(int width, int height);
+
+        int width() const;
+        int height() const;
+
+        void clear();
+        void set(int x, int y, unsigned char color);
+        unsigned char get(int x, int y) const;
+
+        void write(int x, int y, const BitQueue &bits, size_t first, int nr_dots, unsigned char shade);
+        void clear(int x, int y, int nr_dots);
+
+        const uint64_t *valueRow(int y) const;
+        const uint64_t *drawnRow(int y) const;
+
+        void expand(int y, unsigned char *pixels) const;
+        void expand(unsigned char *pixels) const;
+};
+
+#endif // BITRASTER_H
@@ -0,0 +1,146 @@
+#include "columnstats.h"
+#include <cmath>
+#include <cstring>
+
+// 8 planes count up to 255 lines, then they are moved to the totals
+const int ColumnStats::NR_PLANES = 8;
+
+/**
+ * @brief ColumnStats::ColumnStats
+ * @param width the maximum line length, longer lines are cut
+ */
+ColumnStats::ColumnStats(int width)
+    :width(width), nr_words((width + 63) / 64), planes(NR_PLANES * nr_words), nr_pending(0), ones(width), lengths(width + 1), nr_lines(0), line(nr_words)
+{
+}
+
+/**
+ * @brief ColumnStats::add a line of the image
+ * @param pixels of the line, pixels brighter than gray count as ones
+ * @param nr_pixels number of dots on the line
+ */
+void
+ColumnStats::add(const unsigned char *pixels, uint32_t nr_pixels)
+{
+    if (nr_pixels > width) {
+        nr_pixels = width;
+    }
+
+    memset(&line[0], 0, nr_words * sizeof(uint64_t));
+
+    for (uint32_t x=0; x < nr_pixels; x++) {
+        if (pixels[x] > 128) {
+            line[x / 64] |= 0x8000000000000000ULL >> (x % 64);
+        }
+    }
+
+    lengths[nr_pixels]++;
+    addLine();
+}
+
+/**
+ * @brief ColumnStats::addLine adds line to the bit sliced counters, a
+ * ripple carry adder on 64 columns at a time
+ */
+void
+ColumnStats::addLine()
+{
+    for (size_t i=0; i < nr_words; i++) {
+        uint64_t carry = line[i];
+
+        for (int p=0; p < NR_PLANES && carry; p++) {
+            uint64_t &plane = planes[p * nr_words + i];
+            uint64_t next = plane & carry;
+
+            plane ^= carry;
+            carry = next;
+        }
+    }
+
+    nr_lines++;
+
+    // the planes are full once another line could overflow them
+    if (++nr_pending == (1 << NR_PLANES) - 1) {
+        flushPlanes();
+    }
+}
+
+/**
+ * @brief ColumnStats::flushPlanes moves the bit sliced counts to the
+ * per-column totals and clears the planes
+ */
+void
+ColumnStats::flushPlanes()
+{
+    for (size_t i=0; i < nr_words; i++) {
+        uint64_t any = 0;
+
+        for (int p=0; p < NR_PLANES; p++) {
+            any |= planes[p * nr_words + i];
+        }
+
+        // no ones in these 64 columns
+        if (!any) {
+            continue;
+        }
+
+        for (size_t x=i * 64; x < width && x < (i + 1) * 64; x++) {
+            int shift = 63 - (x % 64);
+            uint64_t count = 0;
+
+            for (int p=0; p < NR_PLANES; p++) {
+                count |= ((planes[p * nr_words + i] >> shift) & 1) << p;
+            }
+
+            ones[x] += count;
+        }
+
+        for (int p=0; p < NR_PLANES; p++) {
+            planes[p * nr_words + i] = 0;
+        }
+    }
+
+    nr_pending = 0;
+}
+
+/**
+ * @brief ColumnStats::lines
+ * @return the number of lines added so far
+ */
+uint64_t
+ColumnStats::lines() const
+{
+    return nr_lines;
+}
+
+/**
+ * @brief ColumnStats::get the statistics per column. Only lines long
+ * enough to reach a column count for it, columns no line reached are 0.
+ * @param frequency receives the share of ones per column (0 to 1)
+ * @param entropy receives the binary entropy per column (0 to 1 bit)
+ */
+void
+ColumnStats::get(std::vector<double> &frequency, std::vector<double> &entropy)
+{
+    flushPlanes();
+
+    frequency.assign(width, 0);
+    entropy.assign(width, 0);
+
+    // lines longer than x, counted from the longest lines down
+    uint64_t nr_present = lengths[width];
+
+    for (size_t x=width; x-- > 0; ) {
+        if (nr_present) {
+            double p = (double) ones[x] / nr_present;
+
+            frequency[x] = p;
+
+            if (p > 0 && p < 1) {
+                entropy[x] = -p * std::log(p) / std::log(2.0) - (1 - p) * std::log(1 - p) / std::log(2.0);
+            }
+        }
+
+        nr_present += lengths[x];
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef COLUMNSTATS_H
+#define COLUMNSTATS_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief The ColumnStats class counts the ones per column over all lines
+ * added so far. With start and end pattern defined a line is a packet and
+ * column k is bit k of every packet, thus constant fields, counters and
+ * checksums show up in the frequency of ones and the entropy per column.
+ *
+ * Lines are packed into 64 bit words and added to bit sliced counters
+ * (plane p holds bit p of the count of every column), an addition costs a
+ * few word operations per 64 columns. The planes are moved into the
+ * per-column totals before they could overflow.
+ */
+class ColumnStats
+{
+    private:
+        static const int NR_PLANES;
+
+        size_t width;
+        size_t nr_words;
+
+        // bit sliced counters, NR_PLANES planes of nr_words words, and the
+        // number of lines added to them since they were moved to ones
+        std::vector<uint64_t> planes;
+        int nr_pending;
+
+        // ones per column and histogram of line lengths (0 to width)
+        std::vector<uint64_t> ones;
+        std::vector<uint64_t> lengths;
+        uint64_t nr_lines;
+
+        // the line being added, packed
+        std::vector<uint64_t> line;
+
+        void addLine();
+        void flushPlanes();
+
+    public:
+        ColumnStats(int width);
+
+        void add(const unsigned char *pixels, uint32_t nr_pixels);
+
+        uint64_t lines() const;
+        void get(std::vector<double> &frequency, std::vector<double> &entropy);
+};
+
+#endif // COLUMNSTATS_H
@@ -0,0 +1,172 @@
+#include "densitypyramid.h"
+#include <algorithm>
+
+// 8x8 blocks and up are stored, up to 128x128 dots per pixel (the counts
+// of 16 bit fit 128x128)
+const int DensityPyramid::BASE_LEVEL = 3;
+const int DensityPyramid::MAX_LEVEL = 7;
+
+/**
+ * @brief DensityPyramid::DensityPyramid, all rows are invalid until the
+ * first update()
+ * @param width of the raster
+ * @param height of the raster
+ */
+DensityPyramid::DensityPyramid(int width, int height)
+    :width(width), height(height), invalid_top(0), invalid_bottom(height)
+{
+    for (int level=BASE_LEVEL; level <= MAX_LEVEL; level++) {
+        levels.push_back(std::vector<Count>((size_t) columns(level) * rows(level)));
+    }
+}
+
+/**
+ * @brief DensityPyramid::columns
+ * @return the number of blocks per row of a level (pixels zoomed out)
+ */
+int
+DensityPyramid::columns(int level) const
+{
+    return ((width - 1) >> level) + 1;
+}
+
+/**
+ * @brief DensityPyramid::rows
+ * @return the number of block rows of a level (pixels zoomed out)
+ */
+int
+DensityPyramid::rows(int level) const
+{
+    return ((height - 1) >> level) + 1;
+}
+
+/**
+ * @brief DensityPyramid::invalidate rows of the raster that changed, they
+ * are counted again on the next update()
+ * @param top the first row changed
+ * @param bottom the row behind the last row changed
+ */
+void
+DensityPyramid::invalidate(int top, int bottom)
+{
+    invalid_top = std::min(invalid_top, top);
+    invalid_bottom = std::max(invalid_bottom, bottom);
+}
+
+/**
+ * @brief DensityPyramid::count the on and drawn dots of a row of blocks
+ * from the raster. A block row is a field of bits of a word (blocks of 64
+ * dots at most), counted by popcount.
+ * @param raster counted
+ * @param level blocks of 2^level x 2^level dots (up to 6)
+ * @param block_row the row of blocks
+ * @param counts receives columns(level) counts
+ */
+void
+DensityPyramid::count(const BitRaster &raster, int level, int block_row, Count *counts) const
+{
+    int size = 1 << level;
+    int nr_blocks = columns(level);
+    uint64_t field = size == 64 ? ~0ULL : (1ULL << size) - 1;
+
+    std::fill(counts, counts + nr_blocks, Count());
+
+    for (int y=block_row * size; y < height && y < (block_row + 1) * size; y++) {
+        const uint64_t *value = raster.valueRow(y);
+        const uint64_t *drawn = raster.drawnRow(y);
+
+        for (int x=0, i=0; i < nr_blocks; x += size, i++) {
+            int shift = 64 - size - x % 64;
+            uint64_t set = drawn[x / 64] & (field << shift);
+
+            counts[i].on += __builtin_popcountll(value[x / 64] & set);
+            counts[i].drawn += __builtin_popcountll(set);
+        }
+    }
+}
+
+/**
+ * @brief DensityPyramid::sum a row of blocks of a level from the four
+ * blocks below each (blocks beyond the raster are empty)
+ * @param level above BASE_LEVEL
+ * @param block_row the row of blocks
+ */
+void
+DensityPyramid::sum(int level, int block_row)
+{
+    const std::vector<Count> &below = levels[level - 1 - BASE_LEVEL];
+    Count *counts = &levels[level - BASE_LEVEL][block_row * columns(level)];
+    int below_columns = columns(level - 1);
+    int below_rows = rows(level - 1);
+
+    for (int i=0; i < columns(level); i++) {
+        Count total = Count();
+
+        for (int y=2 * block_row; y < 2 * block_row + 2 && y < below_rows; y++) {
+            for (int x=2 * i; x < 2 * i + 2 && x < below_columns; x++) {
+                total.on += below[y * below_columns + x].on;
+                total.drawn += below[y * below_columns + x].drawn;
+            }
+        }
+
+        counts[i] = total;
+    }
+}
+
+/**
+ * @brief DensityPyramid::update counts the rows invalidated since the last
+ * update again, on all levels
+ * @param raster counted
+ */
+void
+DensityPyramid::update(const BitRaster &raster)
+{
+    if (invalid_top >= invalid_bottom) {
+        return;
+    }
+
+    for (int level=BASE_LEVEL; level <= MAX_LEVEL; level++) {
+        for (int i=invalid_top >> level; i <= (invalid_bottom - 1) >> level; i++) {
+            if (level == BASE_LEVEL) {
+                count(raster, level, i, &levels[0][i * columns(level)]);
+            }
+            else {
+                sum(level, i);
+            }
+        }
+    }
+
+    invalid_top = height;
+    invalid_bottom = 0;
+}
+
+/**
+ * @brief DensityPyramid::draw a row zoomed out, each pixel is the share of
+ * ones of the drawn dots of its block (white is all ones), gray if no dot
+ * of the block was drawn. Call update() before.
+ * @param raster the pyramid counts (levels below BASE_LEVEL are counted
+ * from it right away)
+ * @param level 1 to MAX_LEVEL, blocks of 2^level x 2^level dots
+ * @param y the row zoomed out
+ * @param pixels receives a pixel per block (columns of the level)
+ */
+void
+DensityPyramid::draw(const BitRaster &raster, int level, int y, unsigned char *pixels)
+{
+    const Count *counts;
+
+    if (level < BASE_LEVEL) {
+        scratch.resize(columns(level));
+        count(raster, level, y, &scratch[0]);
+        counts = &scratch[0];
+    }
+    else {
+        counts = &levels[level - BASE_LEVEL][y * columns(level)];
+    }
+
+    for (int i=0; i < columns(level); i++) {
+        unsigned int drawn = counts[i].drawn;
+
+        pixels[i] = drawn ? (counts[i].on * 255 + drawn / 2) / drawn : 128;
+    }
+}
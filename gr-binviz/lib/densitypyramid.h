@@ -0,0 +1,59 @@
+#ifndef DENSITYPYRAMID_H
+#define DENSITYPYRAMID_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include "bitraster.h"
+
+/**
+ * @brief The DensityPyramid class counts the on and drawn dots of square
+ * blocks of a raster to show it zoomed out: at level k a pixel shows the
+ * share of ones of a block of 2^k x 2^k dots. Level k is summed up from
+ * level k-1, the lowest level stored (BASE_LEVEL) from the raster. Rows
+ * changed are invalidated and counted again on the next update() only,
+ * thus a zoomed out frame costs its pixels plus the dots that changed.
+ * Levels below BASE_LEVEL are counted from the raster when drawn (a pixel
+ * covers a few dots only), which keeps the pyramid at a third of the
+ * raster size.
+ */
+class DensityPyramid
+{
+    public:
+        static const int BASE_LEVEL;
+        static const int MAX_LEVEL;
+
+    private:
+        struct Count
+        {
+            uint16_t on;
+            uint16_t drawn;
+        };
+
+        int width;
+        int height;
+
+        // counts of levels BASE_LEVEL to MAX_LEVEL, row by row
+        std::vector<std::vector<Count> > levels;
+
+        // rows changed since the last update [invalid_top, invalid_bottom)
+        int invalid_top;
+        int invalid_bottom;
+
+        // block counts of a row below BASE_LEVEL
+        std::vector<Count> scratch;
+
+        int columns(int level) const;
+        int rows(int level) const;
+        void count(const BitRaster &raster, int level, int block_row, Count *counts) const;
+        void sum(int level, int block_row);
+
+    public:
+        DensityPyramid(int width, int height);
+
+        void invalidate(int top, int bottom);
+        void update(const BitRaster &raster);
+        void draw(const BitRaster &raster, int level, int y, unsigned char *pixels);
+};
+
+#endif // DENSITYPYRAMID_H
@@ -0,0 +1,248 @@
+#include "frameexporter.h"
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <boost/bind.hpp>
+
+/**
+ * @brief FrameExporter::FrameExporter starts the I/O thread
+ * @param snapshot_file each frame is written to this file with a running
+ * number inserted before the extension (e.g. capture.png becomes
+ * capture_000000.png, capture_000001.png, ...). Written as PNG if the
+ * extension is .png, as PGM otherwise. Empty to disable snapshots.
+ * @param stream_file each frame is appended to this file or FIFO, one bit
+ * per pixel (1 for on pixels), most significant bit first, every row
+ * padded to a full byte. Empty to disable the stream.
+ */
+FrameExporter::FrameExporter(const std::string &snapshot_file, const std::string &stream_file)
+    :snapshot_file(snapshot_file), nr_snapshots(0), stream_file(stream_file), stream_fd(-1), stream_failed(false), pending(false), stopping(false), nr_skipped(0)
+{
+    io_thread.reset(new boost::thread(boost::bind(&FrameExporter::run, this)));
+}
+
+/**
+ * @brief FrameExporter::~FrameExporter writes the last submitted frame (if
+ * not written yet), stops the I/O thread and reports skipped frames
+ */
+FrameExporter::~FrameExporter()
+{
+    {
+        boost::mutex::scoped_lock lock(mutex);
+
+        stopping = true;
+        cond.notify_one();
+    }
+
+    io_thread->join();
+
+    if (stream_fd >= 0) {
+        close(stream_fd);
+    }
+
+    if (nr_skipped > 0) {
+        std::cerr << "BinViz: " << nr_skipped << " frames were not exported, the disk did not keep up" << std::endl;
+    }
+}
+
+/**
+ * @brief FrameExporter::submit hands a frame over to the I/O thread. The
+ * frame is copied into the back buffer, nothing is written to disk by
+ * the caller.
+ * @param frame to be exported
+ */
+void
+FrameExporter::submit(const cimg_library::CImg<unsigned char> &frame)
+{
+    boost::mutex::scoped_lock lock(mutex);
+
+    // the I/O thread did not pick up the previous frame, replace it
+    if (pending) {
+        nr_skipped++;
+    }
+
+    // same size as last time, the buffer is reused
+    back = frame;
+    pending = true;
+
+    cond.notify_one();
+}
+
+/**
+ * @brief FrameExporter::run loop of the I/O thread. Waits for a frame,
+ * swaps it to the front buffer and writes it. Pending frames are written
+ * before the thread stops.
+ */
+void
+FrameExporter::run()
+{
+    // a FIFO reader going away must not kill the process, let write()
+    // fail with EPIPE instead
+    sigset_t sigpipe;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, NULL);
+
+    while (true) {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+
+            while (!pending && !stopping) {
+                cond.wait(lock);
+            }
+
+            if (!pending) {
+                break;
+            }
+
+            // the old front buffer becomes the next back buffer
+            front.swap(back);
+            pending = false;
+        }
+
+        if (!snapshot_file.empty()) {
+            writeSnapshot(front);
+        }
+
+        if (!stream_file.empty()) {
+            writeStream(front);
+        }
+    }
+}
+
+/**
+ * @brief FrameExporter::snapshotName
+ * @param nr of the snapshot
+ * @return snapshot_file with _nr inserted before the extension
+ */
+std::string
+FrameExporter::snapshotName(unsigned int nr) const
+{
+    size_t slash = snapshot_file.rfind('/');
+    size_t dot = snapshot_file.rfind('.');
+
+    // no extension (or only a dot in a directory name)
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        dot = snapshot_file.length();
+    }
+
+    char number[16];
+    snprintf(number, sizeof(number), "_%06u", nr);
+
+    return snapshot_file.substr(0, dot) + number + snapshot_file.substr(dot);
+}
+
+/**
+ * @brief FrameExporter::writeSnapshot writes the frame to the next
+ * numbered snapshot file. The file is written under a temporary name
+ * (keeping the extension, external converters rely on it) and renamed
+ * into place so that readers never see a partial image.
+ * @param frame to be written
+ */
+void
+FrameExporter::writeSnapshot(const cimg_library::CImg<unsigned char> &frame)
+{
+    std::string name = snapshotName(nr_snapshots++);
+    size_t dot = name.rfind('.');
+    std::string ext = name.substr(dot);
+    std::string tmp_name = name.substr(0, dot) + ".tmp" + ext;
+
+    try {
+        if (ext == ".png" || ext == ".PNG") {
+            frame.save_png(tmp_name.c_str());
+        }
+        else {
+            frame.save_pnm(tmp_name.c_str());
+        }
+
+        std::rename(tmp_name.c_str(), name.c_str());
+    }
+    catch (cimg_library::CImgException &e) {
+        std::cerr << "BinViz: snapshot to " << name << " failed: " << e.what() << std::endl;
+    }
+}
+
+/**
+ * @brief FrameExporter::writeStream appends the frame to the raw stream,
+ * 1 bit per pixel. The stream is opened on first use. Frames are dropped
+ * while a FIFO has no reader, the FIFO is reopened if its reader goes
+ * away. On other errors the stream is closed and not reopened.
+ * @param frame to be written
+ */
+void
+FrameExporter::writeStream(const cimg_library::CImg<unsigned char> &frame)
+{
+    if (stream_failed) {
+        return;
+    }
+
+    if (stream_fd < 0) {
+
+        // do not wait for a FIFO reader, shutdown would hang without one
+        stream_fd = open(stream_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, 0644);
+
+        // nobody reads the FIFO (yet), the frame is dropped
+        if (stream_fd < 0 && errno == ENXIO) {
+            return;
+        }
+
+        if (stream_fd < 0) {
+            std::cerr << "BinViz: opening stream " << stream_file << " failed: " << strerror(errno) << std::endl;
+            stream_failed = true;
+            return;
+        }
+
+        // frames are written completely, a slow reader only stalls us
+        fcntl(stream_fd, F_SETFL, fcntl(stream_fd, F_GETFL) & ~O_NONBLOCK);
+    }
+
+    // rows are padded to full bytes, same layout as monob raw video
+    int width = frame.width();
+    int height = frame.height();
+    size_t row_bytes = (width + 7) / 8;
+    std::vector<unsigned char> packed(row_bytes * height, 0);
+    const unsigned char *pixel = frame.data();
+
+    for (int y=0; y < height; y++) {
+        unsigned char *row = &packed[y * row_bytes];
+
+        // pixels brighter than gray (cleared) are on
+        for (int x=0; x < width; x++, pixel++) {
+            if (*pixel > 128) {
+                row[x / 8] |= 0x80 >> (x % 8);
+            }
+        }
+    }
+
+    size_t written = 0;
+
+    while (written < packed.size()) {
+        ssize_t nr_bytes = write(stream_fd, &packed[written], packed.size() - written);
+
+        if (nr_bytes < 0 && errno == EINTR) {
+            continue;
+        }
+
+        // the FIFO reader went away, wait for the next one
+        if (nr_bytes < 0 && errno == EPIPE) {
+            close(stream_fd);
+            stream_fd = -1;
+            return;
+        }
+
+        if (nr_bytes <= 0) {
+            std::cerr << "BinViz: writing stream " << stream_file << " failed: " << strerror(errno) << std::endl;
+            close(stream_fd);
+            stream_fd = -1;
+            stream_failed = true;
+            return;
+        }
+
+        written += nr_bytes;
+    }
+}
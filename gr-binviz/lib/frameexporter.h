@@ -0,0 +1,56 @@
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include <string>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "CImg.h"
+
+/**
+ * @brief The FrameExporter class writes frames of the bit raster to disk on
+ * a background I/O thread, as numbered snapshots (PNG or PGM) and/or as a
+ * raw stream of 1 bit per pixel frames to a file or FIFO. Frames are double
+ * buffered: submit() only copies the frame into the back buffer, the I/O
+ * thread swaps it with the front buffer and writes the front buffer without
+ * holding any lock. If the I/O thread is still busy when the next frame is
+ * submitted, the older unwritten frame is replaced and counted as skipped,
+ * thus slow disks never stall the producer.
+ */
+class FrameExporter
+{
+    private:
+        // snapshot file name template and number of the next snapshot
+        std::string snapshot_file;
+        unsigned int nr_snapshots;
+
+        // raw stream, opened by the I/O thread, -1 if not open (yet)
+        std::string stream_file;
+        int stream_fd;
+        bool stream_failed;
+
+        // front is written by the I/O thread, back is filled by submit()
+        cimg_library::CImg<unsigned char> front;
+        cimg_library::CImg<unsigned char> back;
+        bool pending;
+        bool stopping;
+        unsigned long nr_skipped;
+
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        boost::scoped_ptr<boost::thread> io_thread;
+
+        void run();
+        void writeSnapshot(const cimg_library::CImg<unsigned char> &frame);
+        void writeStream(const cimg_library::CImg<unsigned char> &frame);
+        std::string snapshotName(unsigned int nr) const;
+
+    public:
+        FrameExporter(const std::string &snapshot_file = "", const std::string &stream_file = "");
+        ~FrameExporter();
+
+        void submit(const cimg_library::CImg<unsigned char> &frame);
+};
+
+#endif // FRAMEEXPORTER_H
@@ -0,0 +1,690 @@
+#include "framer.h"
+#include <iostream>
+#include <sstream>
+
+/**
+ * @brief Framer::Framer compiles the patterns
+ * @param start_pattern marks start of a packet and puts new line before the pattern (e.g. '101010'), several start patterns are separated by commas (e.g. '101010,110011')
+ * @param end_pattern marks end of packet and wraps to new line
+ * @param drop_pattern will kill all occurences of the pattern recoursively but will not apply if both, start and stop patterns are defined. The drop pattern have precedence over start and stop patterns.
+ * @param skip_zero_bytes ignore any byte composed of zeros, applies before drop, start and stop patterns
+ * @param hash_packets hold packets back until their end and hash them (start and end pattern defined), see FrameEvent::hash
+ * @param start_errors number of bit errors tolerated in a start pattern match
+ * @param end_errors number of bit errors tolerated in an end pattern match
+ * @param start_marks lines (or packets) are started by markStart() instead of the start pattern
+ * @param end_marks lines (or packets) are ended by markEnd() instead of the end pattern
+ * @param input_format packed bytes (most or least significant bit first) or unpacked bits (1 bit per byte)
+ */
+Framer::Framer(const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern, bool skip_zero_bytes, bool hash_packets, int start_errors, int end_errors, bool start_marks, bool end_marks, BitPacker::Format input_format)
+    :packer(input_format), hash_packets(hash_packets), start_emitted(false), packet_offset(0), end(end_pattern), drop(drop_pattern), start_tag(0), start_marks(start_marks), end_marks(end_marks), nr_framed(0)
+{
+    // queues are empty
+    queue.clear();
+    filtered.clear();
+    output.clear();
+
+    // check start and end detection, failover to off on error
+    in_packet = false;
+
+    // several start patterns are separated by commas, the first one is
+    // the start pattern searched by detectStart()
+    std::vector<std::string> start_patterns;
+    std::istringstream patterns(start_pattern);
+
+    while (std::getline(patterns, start, ',')) {
+        if (!checkPattern(start)) {
+            start_patterns.clear();
+            break;
+        }
+
+        if (!start.empty()) {
+            start_patterns.push_back(start);
+        }
+    }
+
+    start = start_patterns.empty() ? "" : start_patterns[0];
+
+    if (start_patterns.size() > 1) {
+        start_set = PatternSet(start_patterns);
+
+        // the automaton only finds exact matches
+        if (start_errors) {
+            std::cerr << "BinViz: bit errors are not tolerated with several start patterns, exact matches only" << std::endl;
+            start_errors = 0;
+        }
+    }
+
+    if (!checkPattern(end)) {
+        end = "";
+    }
+
+    if (!checkPattern(drop)) {
+        drop = "";
+    }
+
+    // framed by marks (e.g. stream tags), no pattern is searched at all
+    if ((start_marks || end_marks) && (!start.empty() || !end.empty())) {
+        std::cerr << "BinViz: lines are framed by tags, start and end patterns are ignored" << std::endl;
+    }
+
+    if (start_marks || end_marks) {
+        start = "";
+        end = "";
+        start_set = PatternSet();
+    }
+
+    // drop pattern does not apply if both, start and end, are defined
+    if ((start.length() > 0 || start_marks) && (end.length() > 0 || end_marks)) {
+        drop = "";
+    }
+
+    // compile patterns once, they are matched bit by bit from now on
+    start_matcher = PatternMatcher(start, checkErrors(start_errors, start));
+    start_length = start_matcher.length();
+    start_keep = start_set.empty() ? start_matcher.length() : start_set.maxLength();
+    end_matcher = PatternMatcher(end, checkErrors(end_errors, end));
+    filter = BitFilter(drop, skip_zero_bytes);
+    start_search = SyncSearch(start);
+    end_search = SyncSearch(end);
+}
+
+/**
+ * @brief Framer::consume one byte and frame it according to
+ * start/stop/drop patterns. See consume(const unsigned char *, size_t).
+ * @param in_byte to be consumed (a single bit if the input is unpacked)
+ */
+void
+Framer::consume(const unsigned char in_byte)
+{
+    consume(&in_byte, 1);
+}
+
+/**
+ * @brief Framer::consume a whole buffer of bytes in one pass. Zero bytes
+ * and drop patterns are removed by the filter first, the clean bits are
+ * framed afterwards. Note, drop patterns will have precedence over start
+ * or stop patterns. Further note, the drop pattern will not be applied
+ * when both, the start and stop pattern are defined. Input other than
+ * bytes packed most significant bit first is packed first, zero bytes are
+ * 8 zero bits in a row then.
+ * @param in pointer to the first byte to be consumed
+ * @param len number of bytes (bits if unpacked) to be consumed
+ */
+void
+Framer::consume(const unsigned char *in, size_t len)
+{
+    // nothing to be filtered or framed, the input goes straight to the
+    // output bits
+    if (filter.empty() && start_matcher.empty() && end_matcher.empty() && !(start_marks && end_marks)) {
+        nr_framed += packer.pack(in, len, output);
+
+        return;
+    }
+
+    if (packer.getFormat() != BitPacker::PACKED_MSB) {
+        packer.pack(in, len, packed);
+
+        in = packed.empty() ? 0 : &packed[0];
+        len = packed.size();
+    }
+
+    filter.push(in, len, filtered);
+    frameFiltered();
+}
+
+/**
+ * @brief Framer::frameFiltered frames the bits cleaned by the filter so
+ * far, without start and end pattern they are moved 64 bits at a time
+ */
+void
+Framer::frameFiltered()
+{
+    if (start_matcher.empty() && end_matcher.empty()) {
+
+        // packets framed by marks, bits out of a packet are never
+        // displayed and hashed packets are held back until their end
+        if (start_marks && end_marks && in_packet && hash_packets) {
+            queue.append(filtered);
+        }
+        // display all bits immediately
+        else if (!(start_marks && end_marks) || in_packet) {
+            output.append(filtered);
+        }
+
+        nr_framed += filtered.size();
+    }
+    else {
+
+        // read 64 bits at a time, frame bit by bit
+        for (size_t i=0; i < filtered.size(); i += 64) {
+            uint64_t word = filtered.word(i);
+
+            for (size_t j=i; j < filtered.size() && j < i + 64; j++) {
+                frame(word >> 63);
+                word <<= 1;
+            }
+        }
+    }
+
+    filtered.clear();
+}
+
+/**
+ * @brief Framer::release frames the bits held back for packing (unpacked
+ * input) or drop detection, they are not part of any later drop pattern
+ */
+void
+Framer::release()
+{
+    unsigned char bits;
+    int nr_bits = packer.takePartial(bits);
+
+    // bits of an incomplete byte are never skipped as zero byte
+    if (nr_bits) {
+        filter.push_bits((uint64_t) bits << (64 - nr_bits), nr_bits);
+    }
+
+    filter.flush(filtered);
+    frameFiltered();
+}
+
+/**
+ * @brief Framer::frame places a bit according to the start and end
+ * patterns (at least one of them is defined, see frameFiltered()). Both
+ * patterns are tracked by sliding window matchers, thus the cost per bit
+ * does not depend on how many bits are queued.
+ * @param bit the next bit of the (drop cleaned) stream
+ */
+void
+Framer::frame(bool bit)
+{
+    nr_framed++;
+
+    // only end pattern is defined
+    if (start_matcher.empty()) {
+
+        // display bits as they come, the end pattern is displayed too
+        output.push_back(bit);
+
+        // wrap to next line of image after the end pattern
+        if (end_matcher.push(bit)) {
+            emit(FrameEvent::WRAP);
+            end_matcher.reset();
+        }
+    }
+    // only start pattern is defined
+    else if (end_matcher.empty()) {
+
+        queue.push_back(bit);
+
+        if (matchStart(bit)) {
+
+            // display bits in front of start pattern
+            flush(queue.size() - start_length);
+
+            // wrap to next line
+            emit(FrameEvent::WRAP);
+
+            // display start pattern
+            flush(start_length);
+            resetStart();
+        }
+
+        // keep start.length()-1 bits as these might match next time
+        flushPartial(start_keep);
+    }
+    // start and end pattern are defined, look for the start
+    else if (!in_packet) {
+
+        queue.push_back(bit);
+
+        if (matchStart(bit)) {
+
+            // remove bits in front of the start pattern and display it
+            remove(queue.size() - start_length);
+            startPacket(nr_framed - start_length);
+            resetStart();
+        }
+        else if (queue.size() >= start_keep) {
+
+            // bits out of a packet are never displayed
+            remove(queue.size() - start_keep + 1);
+        }
+    }
+    // start and end pattern are defined, collect packet until the end
+    else {
+
+        queue.push_back(bit);
+
+        if (end_matcher.push(bit)) {
+
+            // display packet including the end pattern and wrap line
+            endPacket();
+            end_matcher.reset();
+        }
+    }
+}
+
+/**
+ * @brief Framer::startPacket enters a packet, the queue has to hold the
+ * packet bits seen so far (start pattern) only. Hashed packets are
+ * displayed at their end.
+ * @param offset position of the first packet bit in the stream
+ */
+void
+Framer::startPacket(uint64_t offset)
+{
+    packet_offset = offset;
+
+    if (!hash_packets) {
+        emit(FrameEvent::PACKET_START, packet_offset);
+        flush(queue.size());
+    }
+
+    start_emitted = !hash_packets;
+    in_packet = true;
+}
+
+/**
+ * @brief Framer::endPacket displays the packet (including the end pattern)
+ * and wraps to a new line
+ */
+void
+Framer::endPacket()
+{
+    uint32_t length = nr_framed - packet_offset;
+
+    if (!start_emitted) {
+        emit(FrameEvent::PACKET_START, packet_offset, 0, hashQueue());
+    }
+
+    flush(queue.size());
+    emit(FrameEvent::PACKET_END, 0, length);
+    emit(FrameEvent::WRAP);
+
+    in_packet = false;
+}
+
+/**
+ * @brief Framer::markStart starts a line in front of the next bit (start
+ * marks only) or a packet (start and end marks), a start within a packet
+ * is ignored. Marks replace the start pattern, e.g. for streams tagged by
+ * an upstream correlator.
+ */
+void
+Framer::markStart()
+{
+    if (!start_marks) {
+        return;
+    }
+
+    // bits held back for packing or drop detection are in front of the
+    // mark
+    release();
+
+    if (!end_marks) {
+        emit(FrameEvent::WRAP);
+    }
+    else if (!in_packet) {
+        startPacket(nr_framed);
+    }
+}
+
+/**
+ * @brief Framer::markEnd wraps to a new line in front of the next bit (end
+ * marks only) or ends a packet (start and end marks). Marks replace the
+ * end pattern, e.g. for streams tagged by an upstream deframer.
+ */
+void
+Framer::markEnd()
+{
+    if (!end_marks) {
+        return;
+    }
+
+    // bits held back for packing or drop detection are in front of the
+    // mark
+    release();
+
+    if (!start_marks) {
+        emit(FrameEvent::WRAP);
+    }
+    else if (in_packet) {
+        endPacket();
+    }
+}
+
+/**
+ * @brief Framer::matchStart feeds the start pattern matcher (or the
+ * automaton of several start patterns) and remembers which pattern matched
+ * @param bit the next bit of the (drop cleaned) stream
+ * @return true if a start pattern ends with bit
+ */
+bool
+Framer::matchStart(bool bit)
+{
+    if (start_set.empty()) {
+        return start_matcher.push(bit);
+    }
+
+    int pattern = start_set.push(bit);
+
+    if (pattern < 0) {
+        return false;
+    }
+
+    start_tag = pattern;
+    start_length = start_set.length(pattern);
+
+    return true;
+}
+
+/**
+ * @brief Framer::resetStart forgets the bits seen by the start pattern
+ * matcher (or automaton)
+ */
+void
+Framer::resetStart()
+{
+    start_matcher.reset();
+    start_set.reset();
+}
+
+/**
+ * @brief Framer::emit adds an event behind the output bits so far
+ * @param type of the event
+ * @param offset of the packet (PACKET_START only)
+ * @param length of the packet (PACKET_END only)
+ * @param hash of the packet (PACKET_START only)
+ */
+void
+Framer::emit(FrameEvent::Type type, uint64_t offset, uint32_t length, uint64_t hash)
+{
+    FrameEvent event;
+
+    event.type = type;
+    event.pos = output.size();
+    event.offset = offset;
+    event.length = length;
+    event.hash = hash;
+    event.tag = start_tag;
+
+    events.push_back(event);
+}
+
+/**
+ * @brief Framer::checkErrors checks the number of bit errors tolerated in
+ * a match of a pattern, failover to exact matches if it does not fit
+ * @param max_errors number of bit errors
+ * @param pattern to be matched
+ * @return max_errors or 0 if the pattern would match (almost) anything
+ */
+int
+Framer::checkErrors(int max_errors, const std::string &pattern) {
+
+    if (pattern.empty()) {
+        return 0;
+    }
+
+    // at least half of the pattern has to match
+    if (max_errors < 0 || (max_errors > 0 && 2 * max_errors >= (int) pattern.length())) {
+        std::cerr << "BinViz: " << max_errors << " bit errors do not fit pattern " << pattern << ", exact matches only" << std::endl;
+        return 0;
+    }
+
+    return max_errors;
+}
+
+/**
+ * @brief Framer::hashQueue hashes the queued bits 64 at a time (multiply
+ * and xor-shift per word, not cryptographic)
+ * @return the hash, never 0
+ */
+uint64_t
+Framer::hashQueue() const
+{
+    uint64_t hash = queue.size() * 0x9e3779b97f4a7c15ULL;
+
+    for (size_t i=0; i < queue.size(); i += 64) {
+        uint64_t word = queue.word(i);
+
+        // bits behind the queue do not count
+        if (queue.size() - i < 64) {
+            word &= ~(~0ULL >> (queue.size() - i));
+        }
+
+        hash = (hash ^ word) * 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 32;
+    }
+
+    return hash ? hash : 1;
+}
+
+/**
+ * @brief Framer::bits
+ * @return the bits to be displayed since the last clear()
+ */
+const BitQueue &
+Framer::bits() const
+{
+    return output;
+}
+
+/**
+ * @brief Framer::getEvents
+ * @return the events since the last clear(), sorted by position
+ */
+const std::vector<FrameEvent> &
+Framer::getEvents() const
+{
+    return events;
+}
+
+/**
+ * @brief Framer::clear drops the output bits and events once displayed
+ */
+void
+Framer::clear()
+{
+    output.clear();
+    events.clear();
+}
+
+/**
+ * @brief Framer::framesPackets
+ * @return true if both, start and end pattern (or marks), are defined and
+ * thus PACKET_START and PACKET_END events are emitted
+ */
+bool
+Framer::framesPackets() const
+{
+    return (!start_matcher.empty() || start_marks) && (!end_matcher.empty() || end_marks);
+}
+
+/**
+ * @brief Framer::startsLines
+ * @return true if only a start pattern (or start marks) is defined, bits in
+ * front of the first start do not belong to any line then
+ */
+bool
+Framer::startsLines() const
+{
+    return (!start_matcher.empty() || start_marks) && end_matcher.empty() && !end_marks;
+}
+
+/**
+ * @brief Framer::detectPattern
+ * @param matcher of the pattern to search for
+ * @param start_pos improve speed by start searching from start_pos
+ * @return -1 if not matched or vposition that matched (0 for first pos.)
+ */
+int
+Framer::detectPattern(const PatternMatcher &matcher, int start_pos) {
+
+    // assure start_pos fits valid range otherwise search whole queue
+    if (start_pos < 0 || start_pos >= (int) queue.size()) {
+        start_pos=0;
+    }
+
+    // compare 64 bits at a time at each position
+    return matcher.find(queue, start_pos);
+}
+
+/**
+ * @brief Framer::detectStart detects start pattern (the first one if
+ * several are given)
+ * @return position of left most pattern bit if detected otherwise -1
+ */
+int
+Framer::detectStart(int start_pos=0) {
+    return detectPattern(start_matcher, start_pos);
+}
+
+/**
+ * @brief Framer::detectEnd detects end pattern
+ * @return position of right most pattern bit if detected otherwise -1
+ */
+int
+Framer::detectEnd(int start_pos=0) {
+    int len_pattern = end_matcher.length();
+    int pos_pattern = detectPattern(end_matcher, start_pos);
+
+    if (pos_pattern > -1) {
+        return pos_pattern + len_pattern;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Framer::detectStart detects start pattern in a packed buffer (8
+ * bits per byte, most significant bit first) such as a bit dump. The
+ * buffer is searched by the vectorized SyncSearch at all bit phases.
+ * Only exact matches are found, bit errors tolerated in framing do not
+ * apply.
+ * @param buf packed bits
+ * @param nr_bits number of valid bits in buf
+ * @param start_pos position of the first bit a match may start at
+ * @return position of left most pattern bit if detected otherwise -1
+ */
+int64_t
+Framer::detectStart(const unsigned char *buf, uint64_t nr_bits, uint64_t start_pos) const {
+    return start_search.findFirst(buf, nr_bits, start_pos);
+}
+
+/**
+ * @brief Framer::detectEnd detects end pattern in a packed buffer (8 bits
+ * per byte, most significant bit first) such as a bit dump. The buffer is
+ * searched by the vectorized SyncSearch at all bit phases.
+ * Only exact matches are found, bit errors tolerated in framing do not
+ * apply.
+ * @param buf packed bits
+ * @param nr_bits number of valid bits in buf
+ * @param start_pos position of the first bit a match may start at
+ * @return position behind the right most pattern bit if detected otherwise -1
+ */
+int64_t
+Framer::detectEnd(const unsigned char *buf, uint64_t nr_bits, uint64_t start_pos) const {
+    int64_t pos_pattern = end_search.findFirst(buf, nr_bits, start_pos);
+
+    if (pos_pattern > -1) {
+        return pos_pattern + end_search.length();
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Framer::flush outputs all queued and pending bits immediately and
+ * will result in an empty queue.
+ */
+void
+Framer::flush() {
+
+    // bits held back for packing or drop detection pass framing first
+    release();
+
+    // a held back packet is displayed unhashed
+    if (in_packet && !start_emitted) {
+        emit(FrameEvent::PACKET_START, packet_offset);
+        start_emitted = true;
+    }
+
+    flush(queue.size());
+
+    // flushed bits are not part of any later match
+    resetStart();
+    end_matcher.reset();
+}
+
+/**
+ * @brief Framer::remove remove a number of bits from the front of the queue
+ * @param nr_bits the number of bits popped from the front of the queue
+ * @param position skip to this position and remove nr_bits starting at position. 0 if param is omitted.
+ */
+void
+Framer::remove(int nr_bits, int position) {
+
+    // check bounds position and nr_bits
+    if (position < queue.size() && position >= 0
+        && nr_bits >= 1 && nr_bits + position <= queue.size()) {
+
+        // erase part of queue, the shorter side of the queue is moved
+        queue.erase(position, nr_bits);
+    }
+}
+
+/**
+ * @brief Framer::flush outputs a specified number of bits from the queue
+ * @param nr_bits the number of bits taken from the front of the queue and being displayed
+ */
+void
+Framer::flush(int nr_bits) {
+
+    if (nr_bits > (int) queue.size()) {
+        nr_bits = queue.size();
+    }
+
+    // move bits to the output 64 bits at a time
+    for (int i=0; i < nr_bits; i += 64) {
+        int nr_word_bits = nr_bits - i < 64 ? nr_bits - i : 64;
+
+        output.push_bits(queue.word(i), nr_word_bits);
+    }
+
+    // remove output bits from queue at once
+    queue.pop_front(nr_bits);
+}
+
+/**
+ * @brief Framer::flush_partial flushes the queue but keeps keep_bits bits in the queue
+ * @param keep_bits the number of tailing bits to be kept
+ */
+void
+Framer::flushPartial(int keep_bits) {
+
+    // keep end.length()-1 bits as these might match next time
+    if ((int) queue.size() >= keep_bits) {
+        flush(queue.size() - keep_bits + 1);
+    }
+}
+
+/**
+ * @brief Framer::check_pattern if it only consists of '1' and '0'
+ * @param pattern to be checked
+ * @return true if pattern is composed of '1' and '0' only
+ */
+bool
+Framer::checkPattern(const std::string &pattern) {
+
+    // iterate through all characters of the pattern
+    for (int i=0; i < pattern.length(); i++) {
+
+        // break loop if the character does not comply 0 or 1
+        if (pattern[i] != '0' && pattern[i] != '1') {
+            return false;
+        }
+    }
+
+    return true;
+}
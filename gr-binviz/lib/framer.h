@@ -0,0 +1,155 @@
+#ifndef FRAMER_H
+#define FRAMER_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "bitfilter.h"
+#include "bitpacker.h"
+#include "bitqueue.h"
+#include "patternmatcher.h"
+#include "patternset.h"
+#include "syncsearch.h"
+
+/**
+ * @brief The FrameEvent struct marks a position in the framed output
+ */
+struct FrameEvent
+{
+    enum Type {
+        WRAP,
+        PACKET_START,
+        PACKET_END,
+        GAP
+    };
+
+    // WRAP continues on the next line, PACKET_START and PACKET_END
+    // enclose a packet (start and end pattern defined). GAP is never
+    // emitted by the framer, the HandoffRing marks bits and events dropped
+    // on overflow with it.
+    Type type;
+
+    // number of output bits in front of the event
+    size_t pos;
+
+    // PACKET_START: position of the first start pattern bit in the stream
+    // after zero bytes and drop patterns were removed
+    uint64_t offset;
+
+    // PACKET_END: number of bits including start and end pattern
+    uint32_t length;
+
+    // PACKET_START: hash of the packet bits if packets are hashed, 0 if
+    // not hashed (or flushed before its end)
+    uint64_t hash;
+
+    // index of the start pattern the line or packet starts with (0 with a
+    // single start pattern or without any)
+    int tag;
+};
+
+/**
+ * @brief The Framer class arranges a byte stream into lines according to
+ * the start, end and drop patterns. Bytes go in, bits to be displayed and
+ * events (e.g. wrap to a new line) in between come out. The framer does
+ * not know anything about the display, thus streams can be framed
+ * independently (e.g. on worker threads) and displayed later on.
+ */
+class Framer
+{
+    private:
+        // input other than bytes packed most significant bit first is
+        // packed into packed before framing
+        BitPacker packer;
+        std::vector<unsigned char> packed;
+
+        bool in_packet;
+
+        // packets are held back until their end and hashed, thus
+        // PACKET_START, the packet bits and PACKET_END come in one go
+        bool hash_packets;
+        bool start_emitted;
+        uint64_t packet_offset;
+
+        // used as a bit queue ... so we can detect starts or ends
+        BitQueue queue;
+
+        // zero bytes and drop patterns are removed in front of framing,
+        // the clean bits are collected in filtered
+        BitFilter filter;
+        BitQueue filtered;
+
+        // used to detect start and end sequences (wrap to new line)
+        std::string start;
+        std::string end;
+        std::string drop;
+
+        // patterns compiled in the constructor, fed bit by bit
+        PatternMatcher start_matcher;
+        PatternMatcher end_matcher;
+
+        // several start patterns are matched by one automaton instead of
+        // start_matcher. start_length is the length of the start pattern
+        // matched last, start_keep the length of the longest one.
+        PatternSet start_set;
+        size_t start_length;
+        size_t start_keep;
+        int start_tag;
+
+        // lines are framed by markStart() and markEnd() instead of the
+        // start and end patterns
+        bool start_marks;
+        bool end_marks;
+
+        // vectorized search of start and end patterns in bulk input
+        SyncSearch start_search;
+        SyncSearch end_search;
+
+        // number of bits passed to framing so far
+        uint64_t nr_framed;
+
+        // bits to be displayed and events in between, collected until
+        // clear() is called
+        BitQueue output;
+        std::vector<FrameEvent> events;
+
+        int detectPattern(const PatternMatcher &matcher, int start_pos = 0);
+        void frameFiltered();
+        void release();
+        void frame(bool bit);
+        bool matchStart(bool bit);
+        void resetStart();
+        void startPacket(uint64_t offset);
+        void endPacket();
+        void emit(FrameEvent::Type type, uint64_t offset = 0, uint32_t length = 0, uint64_t hash = 0);
+        void remove(int nr_bits, int position = 0);
+        void flush(int nr_bits);
+        void flushPartial(int keep_bits);
+        bool checkPattern(const std::string &pattern);
+        int checkErrors(int max_errors, const std::string &pattern);
+        uint64_t hashQueue() const;
+
+    public:
+        Framer(const std::string &start_pattern = "", const std::string &end_pattern = "", const std::string &drop_pattern = "", bool skip_zero_bytes = false, bool hash_packets = false, int start_errors = 0, int end_errors = 0, bool start_marks = false, bool end_marks = false, BitPacker::Format input_format = BitPacker::PACKED_MSB);
+
+        void consume(const unsigned char in_byte);
+        void consume(const unsigned char *in, size_t len);
+        void markStart();
+        void markEnd();
+        void flush();
+
+        const BitQueue &bits() const;
+        const std::vector<FrameEvent> &getEvents() const;
+        void clear();
+
+        bool framesPackets() const;
+        bool startsLines() const;
+
+        int detectStart(int start_pos);
+        int detectEnd(int start_pos);
+        int64_t detectStart(const unsigned char *buf, uint64_t nr_bits, uint64_t start_pos = 0) const;
+        int64_t detectEnd(const unsigned char *buf, uint64_t nr_bits, uint64_t start_pos = 0) const;
+};
+
+#endif // FRAMER_H
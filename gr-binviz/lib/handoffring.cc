@@ -0,0 +1,260 @@
+#include "handoffring.h"
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+const size_t HandoffRing::CHUNK_BITS = 1024;
+
+// words of an entry in front of its bits
+static const size_t HEADER_WORDS = 7;
+
+/**
+ * @brief HandoffRing::HandoffRing
+ * @param nr_bits number of bits the ring holds at least (rounded up to a
+ * power of two of chunks), events take a chunk each
+ * @param overflow what the producer does once the ring is full
+ * @param on_full called by the producer instead of waiting once the ring
+ * is full (BLOCK only), e.g. to take the entries itself. Consumers have to
+ * be serialized (e.g. by a lock) then. Empty to wait for the consumer.
+ */
+HandoffRing::HandoffRing(size_t nr_bits, Overflow overflow, const boost::function<void ()> &on_full)
+    :overflow(overflow), on_full(on_full), head(0), tail(0), nr_dropped(0), gap(false), dropping(false), expected(0)
+{
+    size_t nr_entries = 2;
+
+    // indices wrap by mask
+    while (nr_entries * CHUNK_BITS < nr_bits) {
+        nr_entries *= 2;
+    }
+
+    entries.resize(nr_entries);
+    mask = nr_entries - 1;
+}
+
+/**
+ * @brief HandoffRing::capacity
+ * @return the number of bits the ring holds if there are no events
+ */
+size_t
+HandoffRing::capacity() const
+{
+    return entries.size() * CHUNK_BITS;
+}
+
+/**
+ * @brief HandoffRing::empty
+ * @return true if the consumer took all entries pushed so far
+ */
+bool
+HandoffRing::empty() const
+{
+    return __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief HandoffRing::dropped
+ * @return the number of entries dropped on overflow so far (not counting
+ * lines dropped by decimation)
+ */
+uint64_t
+HandoffRing::dropped() const
+{
+    return __atomic_load_n(&nr_dropped, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief HandoffRing::copyEntry copies the header and the valid bit words
+ * of an entry with relaxed atomic loads and stores. The consumer may read
+ * an entry the producer overwrites meanwhile (DROP_OLDEST), such a copy is
+ * discarded afterwards but must not read beyond the entry.
+ * @param dst entry copied to
+ * @param src entry copied from
+ */
+void
+HandoffRing::copyEntry(Entry &dst, const Entry &src)
+{
+    uint64_t *to = reinterpret_cast<uint64_t *>(&dst);
+    const uint64_t *from = reinterpret_cast<const uint64_t *>(&src);
+
+    for (size_t i=0; i < HEADER_WORDS; i++) {
+        __atomic_store_n(to + i, __atomic_load_n(from + i, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+
+    size_t nr_words = (std::min<uint64_t>(dst.nr_bits, CHUNK_BITS) + 63) / 64;
+
+    for (size_t i=0; i < nr_words; i++) {
+        __atomic_store_n(dst.bits + i, __atomic_load_n(src.bits + i, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief HandoffRing::reserve makes room for the next entry according to
+ * the overflow policy, producer only
+ * @return false if the entry has to be dropped (DECIMATE)
+ */
+bool
+HandoffRing::reserve()
+{
+    while (head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) > mask) {
+        if (overflow == BLOCK && on_full) {
+            on_full();
+        }
+        else if (overflow == BLOCK) {
+            // sleep is an interruption point, the flow graph stops us here
+            boost::this_thread::sleep(boost::posix_time::microseconds(100));
+        }
+        else if (overflow == DROP_OLDEST) {
+            uint64_t oldest = head - mask - 1;
+
+            // fails if the consumer took the oldest entry meanwhile
+            if (__atomic_compare_exchange_n(&tail, &oldest, oldest + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                __atomic_fetch_add(&nr_dropped, 1, __ATOMIC_RELAXED);
+            }
+        }
+        else {
+            __atomic_fetch_add(&nr_dropped, 1, __ATOMIC_RELAXED);
+            gap = true;
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief HandoffRing::pushEntry writes an entry and publishes it to the
+ * consumer, producer only
+ * @param entry to be pushed, its gap flag is set here
+ */
+void
+HandoffRing::pushEntry(Entry &entry)
+{
+    if (!reserve()) {
+        return;
+    }
+
+    entry.gap = gap;
+    gap = false;
+
+    copyEntry(entries[head & mask], entry);
+    __atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief HandoffRing::push hands framed bits and the events in between
+ * over to the consumer, producer only. The caller keeps the bits and
+ * events, e.g. to clear the framer afterwards.
+ * @param bits framed
+ * @param events in between the bits (see Framer::getEvents())
+ */
+void
+HandoffRing::push(const BitQueue &bits, const std::vector<FrameEvent> &events)
+{
+    Entry entry = Entry();
+    size_t done = 0;
+
+    for (size_t i=0; i <= events.size(); i++) {
+        size_t pos = i < events.size() ? events[i].pos : bits.size();
+
+        // bits up to the event, a chunk at a time
+        for (; done < pos; done += entry.nr_bits) {
+            entry.kind = 0;
+            entry.nr_bits = std::min(pos - done, CHUNK_BITS);
+
+            if (dropping) {
+                continue;
+            }
+
+            for (size_t j=0; j < entry.nr_bits; j += 64) {
+                entry.bits[j / 64] = bits.word(done + j);
+            }
+
+            pushEntry(entry);
+        }
+
+        if (i == events.size()) {
+            break;
+        }
+
+        const FrameEvent &event = events[i];
+
+        if (!dropping) {
+            entry.kind = 1 + event.type;
+            entry.nr_bits = 0;
+            entry.offset = event.offset;
+            entry.length = event.length;
+            entry.hash = event.hash;
+            entry.tag = event.tag;
+
+            pushEntry(entry);
+        }
+
+        // every other line (including the wrap behind it) is dropped as a
+        // whole while the ring is more than half full
+        if (overflow == DECIMATE && event.type == FrameEvent::WRAP) {
+            dropping = !dropping && 2 * (head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE)) > mask + 1;
+        }
+    }
+}
+
+/**
+ * @brief HandoffRing::pop takes the entries pushed so far (a ring full at
+ * most), consumer only. A GAP event is appended where entries were dropped.
+ * @param bits the bits taken are appended to
+ * @param events the events taken are appended to, their positions count
+ * from the start of bits
+ * @return the number of entries taken
+ */
+size_t
+HandoffRing::pop(BitQueue &bits, std::vector<FrameEvent> &events)
+{
+    Entry entry;
+    size_t nr_entries = 0;
+
+    // a ring full at most, a fast producer does not hold us up forever
+    while (nr_entries <= mask) {
+        uint64_t index = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+
+        if (index == __atomic_load_n(&head, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+
+        copyEntry(entry, entries[index & mask]);
+
+        // the producer dropped the entry meanwhile (DROP_OLDEST), the copy
+        // may be torn
+        if (!__atomic_compare_exchange_n(&tail, &index, index + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        FrameEvent event = FrameEvent();
+
+        if (entry.gap || index != expected) {
+            event.type = FrameEvent::GAP;
+            event.pos = bits.size();
+            events.push_back(event);
+        }
+
+        expected = index + 1;
+        nr_entries++;
+
+        if (entry.kind == 0) {
+            for (size_t j=0; j < entry.nr_bits; j += 64) {
+                bits.push_bits(entry.bits[j / 64], std::min<uint64_t>(entry.nr_bits - j, 64));
+            }
+
+            continue;
+        }
+
+        event.type = static_cast<FrameEvent::Type>(entry.kind - 1);
+        event.pos = bits.size();
+        event.offset = entry.offset;
+        event.length = entry.length;
+        event.hash = entry.hash;
+        event.tag = entry.tag;
+        events.push_back(event);
+    }
+
+    return nr_entries;
+}
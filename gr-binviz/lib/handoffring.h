@@ -0,0 +1,100 @@
+#ifndef HANDOFFRING_H
+#define HANDOFFRING_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include <boost/function.hpp>
+#include "bitqueue.h"
+#include "framer.h"
+
+/**
+ * @brief The HandoffRing class hands framed bits and frame events from the
+ * thread feeding the image (producer) to the render thread (consumer)
+ * without a lock. It is a single producer, single consumer ring of fixed
+ * size entries, each holding a chunk of up to CHUNK_BITS bits or a frame
+ * event. Pushing costs a copy per entry, the producer never waits for the
+ * consumer unless the overflow policy is BLOCK.
+ *
+ * Once the ring is full, BLOCK waits for the consumer (or calls on_full,
+ * which may consume the ring on the producer's thread), DROP_OLDEST drops
+ * the oldest entry (the display skips ahead) and DECIMATE drops the
+ * newest entry. DECIMATE additionally drops every other line while the
+ * ring is more than half full, thus the display keeps up with a sample of
+ * whole lines. The consumer receives a FrameEvent::GAP where entries were
+ * dropped.
+ */
+class HandoffRing
+{
+    public:
+        enum Overflow {
+            BLOCK,
+            DROP_OLDEST,
+            DECIMATE
+        };
+
+        static const size_t CHUNK_BITS;
+
+    private:
+        // all fields are 64 bit words, entries are copied word by word
+        // with atomic loads and stores (see copyEntry())
+        struct Entry
+        {
+            // 0 for a chunk of bits, 1 + FrameEvent::Type for an event
+            uint64_t kind;
+
+            // entries were dropped in front of this one
+            uint64_t gap;
+
+            uint64_t nr_bits;
+            uint64_t offset;
+            uint64_t length;
+            uint64_t hash;
+            uint64_t tag;
+            uint64_t bits[16];
+        };
+
+        std::vector<Entry> entries;
+        uint64_t mask;
+        Overflow overflow;
+        boost::function<void ()> on_full;
+
+        // index of the next entry to be written, written by the producer
+        // only. Padded to keep producer and consumer indices on cache
+        // lines of their own.
+        char pad_head[64];
+        uint64_t head;
+
+        // index of the next entry to be read, advanced by the consumer
+        // (and by the producer dropping the oldest entry)
+        char pad_tail[64];
+        uint64_t tail;
+        char pad_end[64];
+
+        // number of entries dropped so far
+        uint64_t nr_dropped;
+
+        // producer only: an entry was dropped in front of the next one,
+        // the current line is dropped (DECIMATE)
+        bool gap;
+        bool dropping;
+
+        // consumer only: index of the entry expected next
+        uint64_t expected;
+
+        static void copyEntry(Entry &dst, const Entry &src);
+        bool reserve();
+        void pushEntry(Entry &entry);
+
+    public:
+        HandoffRing(size_t nr_bits, Overflow overflow = BLOCK, const boost::function<void ()> &on_full = boost::function<void ()>());
+
+        size_t capacity() const;
+        bool empty() const;
+        uint64_t dropped() const;
+
+        void push(const BitQueue &bits, const std::vector<FrameEvent> &events);
+        size_t pop(BitQueue &bits, std::vector<FrameEvent> &events);
+};
+
+#endif // HANDOFFRING_H
@@ -0,0 +1,203 @@
+#include "mappedfile.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// files start with 1 MiB and double from there on
+const size_t MappedFile::MIN_CAPACITY = 1 << 20;
+
+/**
+ * @brief MappedFile::MappedFile creates a closed file, see create() and
+ * open()
+ */
+MappedFile::MappedFile()
+    :fd(-1), base(NULL), capacity(0), writable(false)
+{
+}
+
+/**
+ * @brief MappedFile::~MappedFile unmaps the file, the file keeps its
+ * capacity unless close() was called before
+ */
+MappedFile::~MappedFile()
+{
+    close(capacity);
+}
+
+/**
+ * @brief MappedFile::create creates (or truncates) a file and maps it
+ * @param path of the file
+ * @return true on success
+ */
+bool
+MappedFile::create(const std::string &path)
+{
+    close(0);
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    writable = true;
+
+    if (!map(MIN_CAPACITY)) {
+        close(0);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief MappedFile::open maps an existing file read only, it is never
+ * grown or truncated. Pages are read by the kernel as they are touched,
+ * thus opening a huge file is cheap.
+ * @param path of the file
+ * @return true on success, false if the file can not be opened or is empty
+ */
+bool
+MappedFile::open(const std::string &path)
+{
+    close(0);
+
+    fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(0);
+        return false;
+    }
+
+    void *new_base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if (new_base == MAP_FAILED) {
+        close(0);
+        return false;
+    }
+
+    base = (unsigned char *) new_base;
+    capacity = st.st_size;
+
+    return true;
+}
+
+/**
+ * @brief MappedFile::close unmaps and closes the file
+ * @param size the file is truncated to, i.e. the number of bytes in use
+ * (ignored for files opened read only)
+ */
+void
+MappedFile::close(size_t size)
+{
+    if (base) {
+        munmap(base, capacity);
+        base = NULL;
+    }
+
+    if (fd >= 0) {
+        if (writable && ftruncate(fd, size) != 0) {
+            // the file keeps unused space at its end, nothing is lost
+        }
+
+        ::close(fd);
+        fd = -1;
+    }
+
+    capacity = 0;
+    writable = false;
+}
+
+/**
+ * @brief MappedFile::isOpen
+ * @return true if the file is open and mapped
+ */
+bool
+MappedFile::isOpen() const
+{
+    return base != NULL;
+}
+
+/**
+ * @brief MappedFile::reserve makes sure that at least size bytes are
+ * mapped, grows the file by doubling its size if not
+ * @param size the number of bytes needed
+ * @return true on success, false if the file could not be grown (the old
+ * mapping stays valid)
+ */
+bool
+MappedFile::reserve(size_t size)
+{
+    if (size <= capacity) {
+        return true;
+    }
+
+    if (fd < 0 || !writable) {
+        return false;
+    }
+
+    size_t new_capacity = capacity;
+
+    while (new_capacity < size) {
+        new_capacity *= 2;
+    }
+
+    return map(new_capacity);
+}
+
+/**
+ * @brief MappedFile::data
+ * @return the first byte of the mapping, NULL if not open
+ */
+unsigned char *
+MappedFile::data() const
+{
+    return base;
+}
+
+/**
+ * @brief MappedFile::size
+ * @return the number of bytes mapped: the size of a file opened read only,
+ * the capacity of a created file (0 if not open)
+ */
+size_t
+MappedFile::size() const
+{
+    return capacity;
+}
+
+/**
+ * @brief MappedFile::map resizes the file and maps it
+ * @param size of the file and the mapping
+ * @return true on success, false if the file or the old mapping are
+ * unchanged
+ */
+bool
+MappedFile::map(size_t size)
+{
+    if (ftruncate(fd, size) != 0) {
+        return false;
+    }
+
+    void *new_base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (new_base == MAP_FAILED) {
+        return false;
+    }
+
+    if (base) {
+        munmap(base, capacity);
+    }
+
+    base = (unsigned char *) new_base;
+    capacity = size;
+
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <boost/noncopyable.hpp>
+
+/**
+ * @brief The MappedFile class maps a growing file into memory. The file is
+ * grown (and remapped) by doubling its size, thus appending costs O(1)
+ * amortized and pages that are not in use are left to the kernel instead
+ * of being held in RAM. Pointers into the mapping are invalidated by
+ * reserve(). Existing files (e.g. bit dumps) are mapped read only as a
+ * whole by open().
+ */
+class MappedFile : private boost::noncopyable
+{
+    private:
+        static const size_t MIN_CAPACITY;
+
+        int fd;
+        unsigned char *base;
+        size_t capacity;
+        bool writable;
+
+        bool map(size_t size);
+
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        bool create(const std::string &path);
+        bool open(const std::string &path);
+        void close(size_t size);
+        bool isOpen() const;
+
+        bool reserve(size_t size);
+        unsigned char *data() const;
+        size_t size() const;
+};
+
+#endif // MAPPEDFILE_H
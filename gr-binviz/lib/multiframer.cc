@@ -0,0 +1,287 @@
+#include "multiframer.h"
+#include <algorithm>
+#include <boost/bind.hpp>
+
+/**
+ * @brief lineWord reads 64 bits of a line, bits behind the end of the line
+ * read as 0
+ * @param line to be read
+ * @param pos of the first bit
+ * @return the bits, left aligned
+ */
+static uint64_t
+lineWord(const BitQueue &line, size_t pos)
+{
+    if (pos >= line.size()) {
+        return 0;
+    }
+
+    uint64_t word = line.word(pos);
+    size_t nr_bits = line.size() - pos;
+
+    if (nr_bits < 64) {
+        word &= ~(~0ULL >> nr_bits);
+    }
+
+    return word;
+}
+
+/**
+ * @brief StreamLines::StreamLines
+ * @param width of a line, longer lines are cut
+ * @param start_pattern see BinImg::BinImg()
+ * @param end_pattern see BinImg::BinImg()
+ * @param drop_pattern see BinImg::BinImg()
+ * @param skip_zero_bytes see BinImg::BinImg()
+ */
+StreamLines::StreamLines(int width, const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern, bool skip_zero_bytes)
+    :framer(start_pattern, end_pattern, drop_pattern, skip_zero_bytes), width(width)
+{
+    aligned = !framer.startsLines();
+}
+
+/**
+ * @brief StreamLines::consume frames a buffer and collects its lines
+ * @param in pointer to the first byte to be consumed
+ * @param len number of bytes to be consumed
+ */
+void
+StreamLines::consume(const unsigned char *in, size_t len)
+{
+    framer.consume(in, len);
+    cut();
+}
+
+/**
+ * @brief StreamLines::cut moves the framed bits into lines, a line is
+ * complete at a wrap event or once it is width bits long
+ */
+void
+StreamLines::cut()
+{
+    const BitQueue &bits = framer.bits();
+    const std::vector<FrameEvent> &events = framer.getEvents();
+    size_t done = 0;
+
+    for (size_t i=0; i <= events.size(); i++) {
+        size_t pos = i < events.size() ? events[i].pos : bits.size();
+
+        // bits in front of the first start pattern are dropped
+        while (aligned && done < pos) {
+            size_t nr_bits = std::min(std::min(pos - done, (size_t) 64), width - line.size());
+
+            line.push_bits(bits.word(done), nr_bits);
+            done += nr_bits;
+
+            if (line.size() == width) {
+                lines.push_back(line);
+                line.clear();
+            }
+        }
+
+        done = pos;
+
+        if (i == events.size()) {
+            break;
+        }
+
+        if (events[i].type == FrameEvent::WRAP) {
+
+            // a line cut at width bits was pushed already
+            if (aligned && !line.empty()) {
+                lines.push_back(line);
+                line.clear();
+            }
+
+            aligned = true;
+        }
+    }
+
+    framer.clear();
+}
+
+/**
+ * @brief StreamLines::ready
+ * @return the number of complete lines
+ */
+size_t
+StreamLines::ready() const
+{
+    return lines.size();
+}
+
+/**
+ * @brief StreamLines::front
+ * @return the oldest complete line, ready() has to be > 0
+ */
+const BitQueue &
+StreamLines::front() const
+{
+    return lines.front();
+}
+
+/**
+ * @brief StreamLines::pop drops the oldest complete line
+ */
+void
+StreamLines::pop()
+{
+    lines.pop_front();
+}
+
+/**
+ * @brief MultiFramer::MultiFramer
+ * @param img the lines of all streams are placed into
+ * @param nr_streams number of streams
+ * @param width of a line
+ * @param height of the image, a stream that lags behind more than height
+ * lines is shown as empty lines
+ * @param start_pattern see BinImg::BinImg()
+ * @param end_pattern see BinImg::BinImg()
+ * @param drop_pattern see BinImg::BinImg()
+ * @param skip_zero_bytes see BinImg::BinImg()
+ * @param view INTERLEAVE or DIFF
+ * @param nr_threads number of threads framing the streams, 1 frames all
+ * streams on the calling thread
+ */
+MultiFramer::MultiFramer(BinImg &img, int nr_streams, int width, int height, const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern, bool skip_zero_bytes, View view, int nr_threads)
+    :img(img), view(view), max_backlog(height), stopping(false), job_len(0)
+{
+    for (int i=0; i < nr_streams; i++) {
+        streams.push_back(boost::shared_ptr<StreamLines>(new StreamLines(width, start_pattern, end_pattern, drop_pattern, skip_zero_bytes)));
+    }
+
+    // more threads than streams would idle
+    this->nr_threads = std::max(1, std::min(nr_threads, nr_streams));
+
+    if (this->nr_threads > 1) {
+        start_barrier.reset(new boost::barrier(this->nr_threads + 1));
+        done_barrier.reset(new boost::barrier(this->nr_threads + 1));
+
+        for (int i=0; i < this->nr_threads; i++) {
+            workers.create_thread(boost::bind(&MultiFramer::work, this, i));
+        }
+    }
+}
+
+/**
+ * @brief MultiFramer::~MultiFramer stops the worker threads
+ */
+MultiFramer::~MultiFramer()
+{
+    if (nr_threads > 1) {
+        stopping = true;
+        start_barrier->wait();
+        workers.join_all();
+    }
+}
+
+/**
+ * @brief MultiFramer::work frames the streams of a worker each time
+ * consume() passes the start barrier
+ * @param worker number (0 to nr_threads - 1)
+ */
+void
+MultiFramer::work(int worker)
+{
+    for (;;) {
+        start_barrier->wait();
+
+        if (stopping) {
+            return;
+        }
+
+        for (size_t i=worker; i < streams.size(); i += nr_threads) {
+            streams[i]->consume(job_in[i], job_len);
+        }
+
+        done_barrier->wait();
+    }
+}
+
+/**
+ * @brief MultiFramer::consume frames len bytes of every stream and places
+ * the lines that are complete in all streams
+ * @param in pointer to the first byte of every stream
+ * @param len number of bytes to be consumed per stream
+ */
+void
+MultiFramer::consume(const std::vector<const unsigned char *> &in, size_t len)
+{
+    if (nr_threads > 1) {
+        job_in = in;
+        job_len = len;
+
+        start_barrier->wait();
+        done_barrier->wait();
+    }
+    else {
+        for (size_t i=0; i < streams.size(); i++) {
+            streams[i]->consume(in[i], len);
+        }
+    }
+
+    merge();
+}
+
+/**
+ * @brief MultiFramer::merge places line k of all streams once it is
+ * complete in every stream (or one stream lags behind too much)
+ */
+void
+MultiFramer::merge()
+{
+    const BitQueue empty;
+
+    for (;;) {
+        size_t min_ready = streams[0]->ready();
+        size_t max_ready = streams[0]->ready();
+
+        for (size_t i=1; i < streams.size(); i++) {
+            min_ready = std::min(min_ready, streams[i]->ready());
+            max_ready = std::max(max_ready, streams[i]->ready());
+        }
+
+        if (min_ready == 0 && max_ready <= max_backlog) {
+            break;
+        }
+
+        if (view == INTERLEAVE) {
+            for (size_t i=0; i < streams.size(); i++) {
+                img.putLine(streams[i]->ready() ? streams[i]->front() : empty);
+            }
+        }
+        else {
+            const BitQueue &first = streams[0]->ready() ? streams[0]->front() : empty;
+            size_t length = 0;
+            BitQueue diff;
+
+            for (size_t i=0; i < streams.size(); i++) {
+                if (streams[i]->ready()) {
+                    length = std::max(length, streams[i]->front().size());
+                }
+            }
+
+            // dots are on where any stream differs from the first one
+            for (size_t j=0; j < length; j += 64) {
+                uint64_t word = 0;
+
+                for (size_t i=1; i < streams.size(); i++) {
+                    if (streams[i]->ready()) {
+                        word |= lineWord(first, j) ^ lineWord(streams[i]->front(), j);
+                    }
+                }
+
+                diff.push_bits(word, std::min(length - j, (size_t) 64));
+            }
+
+            img.putLine(diff);
+        }
+
+        for (size_t i=0; i < streams.size(); i++) {
+            if (streams[i]->ready()) {
+                streams[i]->pop();
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef MULTIFRAMER_H
+#define MULTIFRAMER_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <string>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/barrier.hpp>
+#include "bitqueue.h"
+#include "framer.h"
+#include "binimg.h"
+
+/**
+ * @brief The StreamLines class frames one stream and cuts the framed bits
+ * into complete lines. A line ends where the framer wraps or after width
+ * bits. If a start pattern is defined, bits in front of the first start
+ * pattern are dropped, so that every line of every stream begins with the
+ * start pattern.
+ */
+class StreamLines
+{
+    private:
+        Framer framer;
+        size_t width;
+        bool aligned;
+
+        // the line being collected and the complete lines
+        BitQueue line;
+        std::deque<BitQueue> lines;
+
+        void cut();
+
+    public:
+        StreamLines(int width, const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern, bool skip_zero_bytes);
+
+        void consume(const unsigned char *in, size_t len);
+
+        size_t ready() const;
+        const BitQueue &front() const;
+        void pop();
+};
+
+/**
+ * @brief The MultiFramer class frames N streams independently and places
+ * their lines into a single image, either interleaved (line k of every
+ * stream on consecutive rows) or as a diff (one row per line k, dots are
+ * on where any stream differs from the first one). Streams can be framed
+ * on worker threads, lines are merged once all workers are done.
+ */
+class MultiFramer
+{
+    public:
+        enum View {
+            INTERLEAVE,
+            DIFF
+        };
+
+    private:
+        BinImg &img;
+        View view;
+
+        std::vector<boost::shared_ptr<StreamLines> > streams;
+
+        // lines are placed even though some streams lag behind once a
+        // stream has more than max_backlog complete lines
+        size_t max_backlog;
+
+        // worker threads frame streams worker, worker + nr_threads, ...
+        // between the start and the done barrier
+        int nr_threads;
+        boost::thread_group workers;
+        boost::scoped_ptr<boost::barrier> start_barrier;
+        boost::scoped_ptr<boost::barrier> done_barrier;
+        bool stopping;
+
+        // input handed to the workers
+        std::vector<const unsigned char *> job_in;
+        size_t job_len;
+
+        void work(int worker);
+        void merge();
+
+    public:
+        MultiFramer(BinImg &img, int nr_streams, int width, int height, const std::string &start_pattern = "", const std::string &end_pattern = "", const std::string &drop_pattern = "", bool skip_zero_bytes = false, View view = INTERLEAVE, int nr_threads = 1);
+        ~MultiFramer();
+
+        void consume(const std::vector<const unsigned char *> &in, size_t len);
+};
+
+#endif // MULTIFRAMER_H
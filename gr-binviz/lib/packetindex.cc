@@ -0,0 +1,100 @@
+#include "packetindex.h"
+#include <cstring>
+#include <iostream>
+
+const char PacketIndex::MAGIC[] = "BVINDEX";
+const uint32_t PacketIndex::VERSION = 1;
+
+/**
+ * @brief PacketIndex::PacketIndex creates (or truncates) a packet index
+ * file, check isOpen() for success
+ * @param path of the index file
+ */
+PacketIndex::PacketIndex(const std::string &path)
+    :path(path), nr_packets(0)
+{
+    if (!file.create(path)) {
+        std::cerr << "BinViz: creating packet index " << path << " failed" << std::endl;
+        return;
+    }
+
+    PacketIndexHeader *header = (PacketIndexHeader *) file.data();
+
+    memcpy(header->magic, MAGIC, sizeof(header->magic));
+    header->version = VERSION;
+    header->record_size = sizeof(PacketRecord);
+    header->nr_packets = 0;
+    header->reserved = 0;
+}
+
+/**
+ * @brief PacketIndex::~PacketIndex trims the file to the packets in use
+ */
+PacketIndex::~PacketIndex()
+{
+    if (file.isOpen()) {
+        file.close(sizeof(PacketIndexHeader) + nr_packets * sizeof(PacketRecord));
+    }
+}
+
+/**
+ * @brief PacketIndex::isOpen
+ * @return true if packets are recorded
+ */
+bool
+PacketIndex::isOpen() const
+{
+    return file.isOpen();
+}
+
+/**
+ * @brief PacketIndex::packets
+ * @return the number of packets recorded so far, 0 if the file is closed
+ */
+uint64_t
+PacketIndex::packets() const
+{
+    return file.isOpen() ? nr_packets : 0;
+}
+
+/**
+ * @brief PacketIndex::append records a packet. On errors (e.g. disk full)
+ * the file is closed and no further packets are recorded.
+ * @param packet to be recorded
+ */
+void
+PacketIndex::append(const PacketRecord &packet)
+{
+    if (!file.isOpen()) {
+        return;
+    }
+
+    if (!file.reserve(sizeof(PacketIndexHeader) + (nr_packets + 1) * sizeof(PacketRecord))) {
+        std::cerr << "BinViz: growing packet index " << path << " failed, no further packets are recorded" << std::endl;
+        file.close(sizeof(PacketIndexHeader) + nr_packets * sizeof(PacketRecord));
+        return;
+    }
+
+    memcpy(file.data() + sizeof(PacketIndexHeader) + nr_packets * sizeof(PacketRecord), &packet, sizeof(PacketRecord));
+
+    nr_packets++;
+    ((PacketIndexHeader *) file.data())->nr_packets = nr_packets;
+}
+
+/**
+ * @brief PacketIndex::get looks up a packet
+ * @param nr of the packet (0 is the first packet)
+ * @param packet receives the record
+ * @return false if there is no such packet
+ */
+bool
+PacketIndex::get(uint64_t nr, PacketRecord &packet) const
+{
+    if (nr >= packets()) {
+        return false;
+    }
+
+    memcpy(&packet, file.data() + sizeof(PacketIndexHeader) + nr * sizeof(PacketRecord), sizeof(PacketRecord));
+
+    return true;
+}
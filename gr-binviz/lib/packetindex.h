@@ -0,0 +1,73 @@
+#ifndef PACKETINDEX_H
+#define PACKETINDEX_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include "mappedfile.h"
+
+/**
+ * @brief The PacketIndexHeader struct starts a packet index file. It is
+ * followed by nr_packets records of record_size bytes each (see
+ * PacketRecord). All values are stored in host byte order.
+ */
+struct PacketIndexHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t nr_packets;
+    uint64_t reserved;
+};
+
+/**
+ * @brief The PacketRecord struct describes a packet framed by the start
+ * and end patterns
+ */
+struct PacketRecord
+{
+    // position of the first bit of the start pattern in the stream after
+    // zero bytes and drop patterns were removed
+    uint64_t offset;
+
+    // scrollback line the packet starts on
+    uint64_t line;
+
+    // microseconds since the epoch when the start pattern was detected
+    uint64_t timestamp;
+
+    // number of bits including the start and end patterns
+    uint32_t length;
+
+    // index of the start pattern the packet starts with (0 with a single
+    // start pattern)
+    uint32_t tag;
+};
+
+/**
+ * @brief The PacketIndex class keeps a record of every packet in a memory
+ * mapped file. Records have a fixed size, so appending a packet and
+ * looking up packet n are O(1).
+ */
+class PacketIndex
+{
+    private:
+        static const char MAGIC[];
+        static const uint32_t VERSION;
+
+        MappedFile file;
+        std::string path;
+        uint64_t nr_packets;
+
+    public:
+        PacketIndex(const std::string &path);
+        ~PacketIndex();
+
+        bool isOpen() const;
+        uint64_t packets() const;
+
+        void append(const PacketRecord &packet);
+        bool get(uint64_t nr, PacketRecord &packet) const;
+};
+
+#endif // PACKETINDEX_H
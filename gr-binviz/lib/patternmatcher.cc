@@ -0,0 +1,206 @@
+#include "patternmatcher.h"
+
+/**
+ * @brief PatternMatcher::PatternMatcher compiles a pattern
+ * @param pattern composed of '0' and '1' only (check before), an empty
+ * pattern never matches
+ * @param max_errors number of bits that may differ from the pattern in a
+ * match (less than the pattern length, check before)
+ */
+PatternMatcher::PatternMatcher(const std::string &pattern, size_t max_errors)
+    :len(pattern.length()), max_errors(max_errors), filled(0)
+{
+    size_t nr_words = (len + 63) / 64;
+
+    this->pattern.assign(nr_words, 0);
+    window.assign(nr_words, 0);
+    words.assign(nr_words, 0);
+
+    top_mask = len % 64 ? (1ULL << (len % 64)) - 1 : ~0ULL;
+
+    for (size_t i=0; i < len; i++) {
+        bool bit = pattern[i] == '1';
+
+        // right aligned, shift the bit in like push() does
+        for (size_t j=0; j + 1 < nr_words; j++) {
+            this->pattern[j] = (this->pattern[j] << 1) | (this->pattern[j + 1] >> 63);
+        }
+        this->pattern[nr_words - 1] = (this->pattern[nr_words - 1] << 1) | bit;
+
+        // left aligned
+        if (bit) {
+            words[i / 64] |= 1ULL << (63 - i % 64);
+        }
+    }
+}
+
+/**
+ * @brief PatternMatcher::length
+ * @return the number of bits of the pattern
+ */
+size_t
+PatternMatcher::length() const
+{
+    return len;
+}
+
+/**
+ * @brief PatternMatcher::errors
+ * @return the number of bit errors tolerated in a match
+ */
+size_t
+PatternMatcher::errors() const
+{
+    return max_errors;
+}
+
+/**
+ * @brief PatternMatcher::empty
+ * @return true if there is no pattern to be matched
+ */
+bool
+PatternMatcher::empty() const
+{
+    return len == 0;
+}
+
+/**
+ * @brief PatternMatcher::reset forgets all bits seen so far, the next match
+ * needs at least length() new bits
+ */
+void
+PatternMatcher::reset()
+{
+    filled = 0;
+
+    for (size_t i=0; i < window.size(); i++) {
+        window[i] = 0;
+    }
+}
+
+/**
+ * @brief PatternMatcher::push shifts the next bit into the window
+ * @param bit the next bit of the stream
+ * @return true if the window (ending with bit) matches the pattern
+ */
+bool
+PatternMatcher::push(bool bit)
+{
+    if (len == 0) {
+        return false;
+    }
+
+    size_t last = window.size() - 1;
+
+    for (size_t i=0; i < last; i++) {
+        window[i] = (window[i] << 1) | (window[i + 1] >> 63);
+    }
+    window[last] = (window[last] << 1) | bit;
+
+    if (filled < len) {
+        filled++;
+
+        if (filled < len) {
+            return false;
+        }
+    }
+
+    // exact matches compare words
+    if (!max_errors) {
+        if ((window[0] & top_mask) != pattern[0]) {
+            return false;
+        }
+
+        for (size_t i=1; i <= last; i++) {
+            if (window[i] != pattern[i]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // tolerant matches count the differing bits
+    size_t nr_errors = __builtin_popcountll((window[0] & top_mask) ^ pattern[0]);
+
+    for (size_t i=1; i <= last && nr_errors <= max_errors; i++) {
+        nr_errors += __builtin_popcountll(window[i] ^ pattern[i]);
+    }
+
+    return nr_errors <= max_errors;
+}
+
+/**
+ * @brief PatternMatcher::prime resets the window and loads it with the
+ * last length()-1 bits of a queue (or less if the queue is shorter). Use
+ * this after bits have been taken from the end of the stream.
+ * @param queue holding the stream
+ */
+void
+PatternMatcher::prime(const BitQueue &queue)
+{
+    reset();
+
+    if (len == 0) {
+        return;
+    }
+
+    size_t nr_bits = queue.size() < len - 1 ? queue.size() : len - 1;
+
+    for (size_t i=queue.size() - nr_bits; i < queue.size(); i++) {
+        push(queue.at(i));
+    }
+}
+
+/**
+ * @brief PatternMatcher::matches compares the pattern to queued bits, 64
+ * bits at a time
+ * @param queue holding the bits
+ * @param pos of the first bit to be compared
+ * @return true if the pattern matches at pos
+ */
+bool
+PatternMatcher::matches(const BitQueue &queue, size_t pos) const
+{
+    if (len == 0 || pos + len > queue.size()) {
+        return false;
+    }
+
+    size_t nr_errors = 0;
+
+    for (size_t i=0; i < words.size(); i++) {
+        uint64_t diff = queue.word(pos + i * 64) ^ words[i];
+        size_t remaining = len - i * 64;
+
+        // ignore queued bits behind the end of the pattern
+        if (remaining < 64) {
+            diff &= ~(~0ULL >> remaining);
+        }
+
+        nr_errors += __builtin_popcountll(diff);
+
+        if (nr_errors > max_errors) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief PatternMatcher::find searches queued bits for the pattern
+ * @param queue holding the bits
+ * @param start_pos position of the first bit a match may start at
+ * @return position of the left most match at or after start_pos or -1
+ */
+int
+PatternMatcher::find(const BitQueue &queue, size_t start_pos) const
+{
+    for (size_t pos=start_pos; pos + len <= queue.size(); pos++) {
+        if (matches(queue, pos)) {
+            return pos;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,58 @@
+#ifndef PATTERNMATCHER_H
+#define PATTERNMATCHER_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "bitqueue.h"
+
+/**
+ * @brief The PatternMatcher class detects a pattern of 0s and 1s in a bit
+ * stream. The pattern is compiled once into 64 bit words. Incoming bits
+ * are shifted into a sliding window of the same size, so each bit costs
+ * one shift and one compare per 64 pattern bits regardless of how many
+ * bits have been seen before.
+ *
+ * A match may tolerate up to max_errors bit errors (Hamming distance).
+ * The window is then XORed with the pattern and the differing bits are
+ * counted by popcount, again one operation per 64 pattern bits.
+ */
+class PatternMatcher
+{
+    private:
+        size_t len;
+        size_t max_errors;
+
+        // number of valid bits in the window, saturates at len
+        size_t filled;
+
+        // pattern right aligned (last bit is the least significant bit
+        // of the last word) and the sliding window of the newest bits
+        // in the same layout
+        std::vector<uint64_t> pattern;
+        std::vector<uint64_t> window;
+
+        // pattern left aligned (first bit is the most significant bit of
+        // the first word) to compare with BitQueue::word() reads
+        std::vector<uint64_t> words;
+
+        // valid bits of the first right aligned word
+        uint64_t top_mask;
+
+    public:
+        PatternMatcher(const std::string &pattern = "", size_t max_errors = 0);
+
+        size_t length() const;
+        size_t errors() const;
+        bool empty() const;
+
+        void reset();
+        bool push(bool bit);
+        void prime(const BitQueue &queue);
+
+        bool matches(const BitQueue &queue, size_t pos) const;
+        int find(const BitQueue &queue, size_t start_pos = 0) const;
+};
+
+#endif // PATTERNMATCHER_H
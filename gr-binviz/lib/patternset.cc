@@ -0,0 +1,138 @@
+#include "patternset.h"
+#include <deque>
+
+/**
+ * @brief PatternSet::PatternSet compiles the patterns
+ * @param patterns composed of '0' and '1' only (check before), an empty
+ * set never matches. If a pattern is listed twice the first one is
+ * reported.
+ */
+PatternSet::PatternSet(const std::vector<std::string> &patterns)
+    :next(2, 0), output(1, -1), max_len(0), state(0)
+{
+    // trie of all patterns, 0 marks a missing transition (the root is
+    // never a target)
+    for (size_t i=0; i < patterns.size(); i++) {
+        int32_t s = 0;
+
+        for (size_t j=0; j < patterns[i].length(); j++) {
+            int bit = patterns[i][j] == '1';
+
+            if (!next[2 * s + bit]) {
+                next[2 * s + bit] = output.size();
+                next.push_back(0);
+                next.push_back(0);
+                output.push_back(-1);
+            }
+
+            s = next[2 * s + bit];
+        }
+
+        if (output[s] < 0 && !patterns[i].empty()) {
+            output[s] = i;
+        }
+
+        lengths.push_back(patterns[i].length());
+
+        if (patterns[i].length() > max_len) {
+            max_len = patterns[i].length();
+        }
+    }
+
+    // breadth first, the failure state of a state is complete before the
+    // state is, missing transitions continue where the failure state does
+    std::vector<int32_t> fail(output.size(), 0);
+    std::deque<int32_t> states;
+
+    for (int bit=0; bit < 2; bit++) {
+        if (next[bit]) {
+            states.push_back(next[bit]);
+        }
+    }
+
+    while (!states.empty()) {
+        int32_t s = states.front();
+        states.pop_front();
+
+        // a pattern ending here is longer than any ending at the failure
+        if (output[s] < 0) {
+            output[s] = output[fail[s]];
+        }
+
+        for (int bit=0; bit < 2; bit++) {
+            int32_t t = next[2 * s + bit];
+
+            if (t) {
+                fail[t] = next[2 * fail[s] + bit];
+                states.push_back(t);
+            }
+            else {
+                next[2 * s + bit] = next[2 * fail[s] + bit];
+            }
+        }
+    }
+}
+
+/**
+ * @brief PatternSet::size
+ * @return the number of patterns
+ */
+size_t
+PatternSet::size() const
+{
+    return lengths.size();
+}
+
+/**
+ * @brief PatternSet::empty
+ * @return true if there is no pattern to be matched
+ */
+bool
+PatternSet::empty() const
+{
+    return max_len == 0;
+}
+
+/**
+ * @brief PatternSet::length
+ * @param pattern index of the pattern
+ * @return the number of bits of the pattern
+ */
+size_t
+PatternSet::length(int pattern) const
+{
+    return lengths[pattern];
+}
+
+/**
+ * @brief PatternSet::maxLength
+ * @return the number of bits of the longest pattern
+ */
+size_t
+PatternSet::maxLength() const
+{
+    return max_len;
+}
+
+/**
+ * @brief PatternSet::reset forgets all bits seen so far
+ */
+void
+PatternSet::reset()
+{
+    state = 0;
+}
+
+/**
+ * @brief PatternSet::push advances the automaton by the next bit
+ * @param bit the next bit of the stream
+ * @return index of the pattern ending with bit (the longest one if several
+ * do) or -1
+ */
+int
+PatternSet::push(bool bit)
+{
+    state = next[2 * state + bit];
+
+    return output[state];
+}
@@ -0,0 +1,44 @@
+#ifndef PATTERNSET_H
+#define PATTERNSET_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The PatternSet class detects any of several patterns of 0s and 1s
+ * in a bit stream. The patterns are compiled once into a bit level
+ * Aho-Corasick automaton (trie plus failure links folded into a two way
+ * transition table), each incoming bit costs one table lookup regardless
+ * of the number and length of the patterns.
+ */
+class PatternSet
+{
+    private:
+        // transitions on 0 and 1 of state s at 2*s and 2*s+1, state 0
+        // is the root
+        std::vector<int32_t> next;
+
+        // pattern matched when entering a state (the longest one if
+        // several end there), -1 if none
+        std::vector<int32_t> output;
+
+        std::vector<size_t> lengths;
+        size_t max_len;
+
+        int32_t state;
+
+    public:
+        PatternSet(const std::vector<std::string> &patterns = std::vector<std::string>());
+
+        size_t size() const;
+        bool empty() const;
+        size_t length(int pattern) const;
+        size_t maxLength() const;
+
+        void reset();
+        int push(bool bit);
+};
+
+#endif // PATTERNSET_H
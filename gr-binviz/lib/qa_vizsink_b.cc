@@ -21,16 +21,108 @@
 #include <gnuradio/attributes.h>
 #include <cppunit/TestAssert.h>
 #include <binviz/vizsink_b.h>
+#include <cmath>
 #include <ctime>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <deque>
+#include <string>
+#include <unistd.h>
 
 #include "qa_vizsink_b.h"
 #include "binimg.h"
+#include "bitfilter.h"
+#include "bitpacker.h"
+#include "bitqueue.h"
+#include "bitraster.h"
+#include "columnstats.h"
+#include "densitypyramid.h"
+#include "framer.h"
+#include "handoffring.h"
+#include "multiframer.h"
+#include "patternmatcher.h"
+#include "patternset.h"
+#include "scrollback.h"
+#include "syncsearch.h"
 
 #include "CImg.h"
 
 namespace gr {
     namespace binviz {
 
+        /**
+         * @brief headless tells whether the suite runs unattended. Set
+         * BINVIZ_QA_INTERACTIVE in the environment to open windows, pause
+         * and wait for user input in order to check the images visually.
+         */
+        static bool
+        headless()
+        {
+            return getenv("BINVIZ_QA_INTERACTIVE") == NULL;
+        }
+
+        /**
+         * @brief framing options of an image, shown only in interactive
+         * runs
+         */
+        static BinImg::Options
+        framing(const std::string &start_pattern = "", const std::string &end_pattern = "", const std::string &drop_pattern = "", bool skip_zero_bytes = false)
+        {
+            BinImg::Options options;
+
+            options.start_pattern = start_pattern;
+            options.end_pattern = end_pattern;
+            options.drop_pattern = drop_pattern;
+            options.skip_zero_bytes = skip_zero_bytes;
+            options.headless = headless();
+
+            return options;
+        }
+
+        /**
+         * @brief delay sleeps in interactive runs only
+         */
+        static void
+        delay(unsigned int seconds)
+        {
+            if (!headless()) {
+                sleep(seconds);
+            }
+        }
+
+        /**
+         * @brief timestamp prints the time in interactive runs only
+         */
+        static void
+        timestamp()
+        {
+            if (!headless()) {
+                time_t now = time(0);
+                std::cout << ctime(&now);
+            }
+        }
+
+        /**
+         * @brief raster reads a row of an image as string of '1' (on, any
+         * shade), '0' (off) and '.' (clear) dots, trailing clear dots are
+         * cut off
+         */
+        static std::string
+        raster(BinImg &img, int y)
+        {
+            std::string row;
+
+            for (int x=0; x < img.width(); x++) {
+                unsigned char pixel = img.getPixel(x, y);
+
+                row += pixel == 128 ? '.' : pixel == 0 ? '0' : '1';
+            }
+
+            return row.substr(0, row.find_last_not_of('.') + 1);
+        }
+
         /**
          * @brief qa_vizsink_b::t1 mainly aims to check simple
          * functionality such as creating an image and switching pixels.
@@ -47,7 +139,7 @@ namespace gr {
             int height = (width * 1.414);
             bool onoff = true;
 
-            BinImg img(width, height);
+            BinImg img(width, height, framing());
 
             for (int i=0; i<4; i++) {
 
@@ -59,10 +151,16 @@ namespace gr {
                 }
 
                 onoff = !onoff;
-                sleep(1);
+                delay(1);
             }
 
             img.on(width-1,height-1);
+
+            // pixels are set aside of the cursor
+            CPPUNIT_ASSERT_EQUAL(std::string("1010"), raster(img, 0));
+            CPPUNIT_ASSERT_EQUAL(0, img.getPosition());
+            CPPUNIT_ASSERT_EQUAL((unsigned char) 0, img.getPixel(width-2, height-1));
+            CPPUNIT_ASSERT_EQUAL((unsigned char) 255, img.getPixel(width-1, height-1));
             img.wait();
         }
 
@@ -81,10 +179,13 @@ namespace gr {
             int width = 50;
             int height = (width * 1.414);
 
-            BinImg img(width, height);
-            sleep(2);
+            BinImg img(width, height, framing());
+            delay(2);
             img.consume(test_in);
-            sleep(2);
+            delay(2);
+
+            CPPUNIT_ASSERT_EQUAL(std::string("10101010"), raster(img, 0));
+            CPPUNIT_ASSERT_EQUAL(8, img.getPosition());
             img.wait();
         }
 
@@ -101,33 +202,43 @@ namespace gr {
         void
         qa_vizsink_b::t3()
         {
-            BinImg img(50,70, "1010");
+            BinImg img(50, 70, framing("1010"));
 
             img.consume(0b00000011);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b10101011);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b00000011);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b10101011);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b00010101);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b11111111);
             img.wait();
 
-            sleep(1);
+            // the last 3 bits might be part of a start pattern
+            CPPUNIT_ASSERT_EQUAL(std::string("00000011"), raster(img, 0));
+            CPPUNIT_ASSERT_EQUAL(std::string("1010101100000011"), raster(img, 1));
+            CPPUNIT_ASSERT_EQUAL(std::string("10101011000"), raster(img, 2));
+            CPPUNIT_ASSERT_EQUAL(std::string("1010111111"), raster(img, 3));
+
+            delay(1);
             img.flush();
+
+            CPPUNIT_ASSERT_EQUAL(std::string("1010111111111"), raster(img, 3));
+            CPPUNIT_ASSERT_EQUAL(std::string(""), raster(img, 4));
+            CPPUNIT_ASSERT_EQUAL(3 * 50 + 13, img.getPosition());
             img.wait();
         }
 
@@ -141,48 +252,57 @@ namespace gr {
         void
         qa_vizsink_b::t4()
         {
-            BinImg img(50,5, "", "1111");
+            BinImg img(50, 5, framing("", "1111"));
 
             img.consume(0b11110001);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b10110001);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b00111101);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b11100001);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b11110001);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b10110001);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b00111101);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b11100001);
             img.wait();
-            sleep(1);
+            delay(1);
             img.consume(0b11110001);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.consume(0b10110001);
             img.wait();
 
-            sleep(1);
+            delay(1);
             img.flush();
+
+            // lines 6 to 8 overwrite rows 0 to 2, the wrap behind line 5
+            // on the last row keeps the dummy pixel
+            CPPUNIT_ASSERT_EQUAL(std::string("01111"), raster(img, 0));
+            CPPUNIT_ASSERT_EQUAL(std::string("00001111"), raster(img, 1));
+            CPPUNIT_ASSERT_EQUAL(std::string("1000110110001"), raster(img, 2));
+            CPPUNIT_ASSERT_EQUAL(std::string("00001111"), raster(img, 3));
+            CPPUNIT_ASSERT_EQUAL(std::string("1000110110001001111"), raster(img, 4).substr(0, 19));
+            CPPUNIT_ASSERT_EQUAL(2 * 50 + 13, img.getPosition());
             img.wait();
         }
 
@@ -198,43 +318,41 @@ namespace gr {
         void
         qa_vizsink_b::t5()
         {
-            time_t now = time(0);
-            char* dt = ctime(&now);
-            std::cout << dt;
+            timestamp();
 
-            BinImg img(50,10, "10101010", "1111");
+            BinImg img(50, 10, framing("10101010", "1111"));
             img.consume(0b00001010);
             img.consume(0b00001010);
-            sleep(1);
+            delay(1);
 
             img.consume(0b10101001);
             img.consume(0b10010110);
-            sleep(1);
+            delay(1);
 
             img.consume(0b01100111);
             img.consume(0b10010100);
-            sleep(1);
+            delay(1);
 
             img.consume(0b00101010);
             img.consume(0b10101001);
-            sleep(1);
+            delay(1);
 
             img.consume(0b10010110);
             img.consume(0b01100111);
-            sleep(1);
+            delay(1);
 
             img.consume(0b10010100);
             img.consume(0b10010100);
-            sleep(1);
-            img.wait();
+            delay(1);
 
-            now = time(0);
-            dt = ctime(&now);
-            std::cout << dt;
+            // bits in front of and behind the packets are dropped
+            CPPUNIT_ASSERT_EQUAL(std::string("10101010100110010110011001111"), raster(img, 0));
+            CPPUNIT_ASSERT_EQUAL(std::string("1010101010100110010110011001111"), raster(img, 1));
+            CPPUNIT_ASSERT_EQUAL(std::string(""), raster(img, 2));
+            CPPUNIT_ASSERT_EQUAL(2 * 50, img.getPosition());
+            img.wait();
 
-            now = time(0);
-            dt = ctime(&now);
-            std::cout << dt;
+            timestamp();
         }
 
         /**
@@ -248,49 +366,68 @@ namespace gr {
         qa_vizsink_b::t6()
         {
             /**
-             * @brief img should display 5 pixels (b,w,b,w,b)
+             * @brief img should display 7 pixels (b,w,b,w,b,w,b)
              */
-            BinImg img(50,10, "", "", "000");
+            BinImg img(50, 10, framing("", "", "000"));
             img.consume(0b00001010);
             img.consume(0b00000010);
             img.flush();
-            sleep(1);
+            delay(1);
+
+            CPPUNIT_ASSERT_EQUAL(std::string("0101010"), raster(img, 0));
+            CPPUNIT_ASSERT_EQUAL(std::string(""), raster(img, 1));
             img.wait();
 
             /**
-             * @brief img2 should display 3 lines. First line empty,
-             * second line (b,w,b,w), third line (b,w,b,b,w,w,b,b,ww)
+             * @brief img2 should display 3 lines. First line empty (the
+             * stream starts with the start pattern), second line
+             * (b,w,b,w,b), third line (b,w,b,b,w,w,b,b,w,w)
              */
-            BinImg img2(50,10, "010", "", "000");
+            BinImg img2(50, 10, framing("010", "", "000"));
             img2.consume(0b00001010);
             img2.consume(0b00000001);
             img2.consume(0b00110011);
             img2.flush();
-            sleep(1);
+            delay(1);
+
+            CPPUNIT_ASSERT_EQUAL(std::string(""), raster(img2, 0));
+            CPPUNIT_ASSERT_EQUAL(std::string("01010"), raster(img2, 1));
+            CPPUNIT_ASSERT_EQUAL(std::string("0100110011"), raster(img2, 2));
+            CPPUNIT_ASSERT_EQUAL(std::string(""), raster(img2, 3));
             img2.wait();
 
             /**
              * @brief img3 should display 3 lines. First line (b,w,b),
              * second line (w,b,b,w,b), third line (b,w,w,b,b,w,w)
              */
-            BinImg img3(50,10, "", "010", "000");
+            BinImg img3(50, 10, framing("", "010", "000"));
             img3.consume(0b00001010);
             img3.consume(0b00000001);
             img3.consume(0b00110011);
             img3.flush();
-            sleep(1);
+            delay(1);
+
+            CPPUNIT_ASSERT_EQUAL(std::string("010"), raster(img3, 0));
+            CPPUNIT_ASSERT_EQUAL(std::string("10010"), raster(img3, 1));
+            CPPUNIT_ASSERT_EQUAL(std::string("0110011"), raster(img3, 2));
+            CPPUNIT_ASSERT_EQUAL(std::string(""), raster(img3, 3));
             img3.wait();
 
             /**
-             * @brief img4 single line displayed where 0 is b and 1 is w.
-             * This should acutually not drop any 000 sequences
+             * @brief img4 does not drop any 000 sequences (start and end
+             * pattern defined). There is no packet, only the last 8 bits
+             * (held back as they might be part of a start pattern) are
+             * displayed on flush.
              */
-            BinImg img4(50,10, "010010101", "1111", "000");
+            BinImg img4(50, 10, framing("010010101", "1111", "000"));
             img4.consume(0b00001010);
             img4.consume(0b00000001);
             img4.consume(0b00110011);
             img4.flush();
-            sleep(1);
+            delay(1);
+
+            CPPUNIT_ASSERT_EQUAL(std::string("00110011"), raster(img4, 0));
+            CPPUNIT_ASSERT_EQUAL(std::string(""), raster(img4, 1));
             img4.wait();
         }
 
@@ -309,12 +446,1449 @@ namespace gr {
              * which causes the pattern to be detected over and over again
              * but got never removed due to wrong bounds checking.
              */
-            BinImg img(50,10, "", "", "0000");
+            BinImg img(50, 10, framing("", "", "0000"));
             img.consume(0b00000000);
             img.consume(0b10000000);
             img.flush();
-            sleep(1);
+            delay(1);
+
+            CPPUNIT_ASSERT_EQUAL(std::string("1000"), raster(img, 0));
+            CPPUNIT_ASSERT_EQUAL(4, img.getPosition());
             img.wait();
         }
+
+        /**
+         * @brief qa_vizsink_b::t8 checks the batched consume(in, len) path
+         * against the old one byte per call ingest (as work() used to do).
+         * Both images are fed with the same random bytes (with runs of
+         * zero bytes) and have to end up pixel by pixel identical, with
+         * the start/end patterns of t5 and with zero bytes and a drop
+         * pattern filtered.
+         *
+         * Note, there will be two dummy pixels in the lower right corner.
+         */
+        void
+        qa_vizsink_b::t8()
+        {
+            const size_t nr_bytes = 4096;
+            std::vector<unsigned char> data(nr_bytes);
+
+            srand(42);
+            for (size_t i=0; i < nr_bytes; i++) {
+                data[i] = rand() % 4 == 0 ? 0 : rand() & 0xff;
+            }
+
+            for (int skip=0; skip < 2; skip++) {
+                std::string drop = skip ? "0110" : "";
+
+                // before: one consume() call per byte
+                BinImg img(200, 100, framing("10101010", "1111", drop, skip));
+
+                for (size_t i=0; i < nr_bytes; i++) {
+                    img.consume(data[i]);
+                }
+
+                img.flush();
+
+                // after: the whole buffer at once
+                BinImg img2(200, 100, framing("10101010", "1111", drop, skip));
+
+                img2.consume(&data[0], nr_bytes);
+                img2.flush();
+
+                CPPUNIT_ASSERT_EQUAL(img.getPosition(), img2.getPosition());
+
+                for (int y=0; y < img.height(); y++) {
+                    for (int x=0; x < img.width(); x++) {
+                        CPPUNIT_ASSERT_EQUAL((int) img.getPixel(x, y), (int) img2.getPixel(x, y));
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t9 checks the packed BitQueue against the
+         * std::deque<bool> it replaced. Random pushes, pops and erases are
+         * applied to both and the queued bits have to be equal after each
+         * operation, including the 64 bit word reads.
+         */
+        void
+        qa_vizsink_b::t9()
+        {
+            BitQueue queue;
+            std::deque<bool> model;
+
+            srand(9);
+            for (int op=0; op < 20000; op++) {
+
+                switch (rand() % 4) {
+                    case 0: {
+                        unsigned char byte = rand() & 0xff;
+
+                        queue.push_byte(byte);
+                        for (int i=7; i>=0; i--) {
+                            model.push_back(byte & (1 << i));
+                        }
+                        break;
+                    }
+                    case 1: {
+                        bool bit = rand() & 1;
+
+                        queue.push_back(bit);
+                        model.push_back(bit);
+                        break;
+                    }
+                    case 2: {
+                        size_t nr_bits = model.size() ? rand() % (model.size() + 1) / 2 : 0;
+
+                        queue.pop_front(nr_bits);
+                        model.erase(model.begin(), model.begin() + nr_bits);
+                        break;
+                    }
+                    case 3: {
+                        if (model.empty()) {
+                            break;
+                        }
+
+                        size_t pos = rand() % model.size();
+                        size_t nr_bits = 1 + rand() % (model.size() - pos);
+
+                        queue.erase(pos, nr_bits);
+                        model.erase(model.begin() + pos, model.begin() + pos + nr_bits);
+                        break;
+                    }
+                }
+
+                CPPUNIT_ASSERT_EQUAL(model.size(), queue.size());
+
+                for (size_t i=0; i < model.size(); i++) {
+                    CPPUNIT_ASSERT_EQUAL((bool) model[i], queue.at(i));
+                }
+
+                if (!model.empty()) {
+                    size_t pos = rand() % model.size();
+                    uint64_t bits = queue.word(pos);
+
+                    for (size_t i=pos; i < pos + 64; i++, bits <<= 1) {
+                        bool bit = i < model.size() ? model[i] : false;
+
+                        CPPUNIT_ASSERT_EQUAL(bit, (bool) (bits >> 63));
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t10 checks the sliding window matcher with
+         * sync words of 1 to 130 bits (crossing one and two word
+         * boundaries) against a plain string compare of the stream tail,
+         * as well as the word wise search of queued bits.
+         */
+        void
+        qa_vizsink_b::t10()
+        {
+            srand(10);
+
+            for (int len=1; len <= 130; len++) {
+                std::string pattern;
+                std::string stream;
+                BitQueue queue;
+
+                for (int i=0; i < len; i++) {
+                    pattern += (rand() & 1) ? '1' : '0';
+                }
+
+                PatternMatcher matcher(pattern);
+                CPPUNIT_ASSERT_EQUAL((size_t) len, matcher.length());
+
+                while (stream.size() < 2000) {
+
+                    // plant the whole pattern now and then, random bits otherwise
+                    std::string bits = rand() % 8 == 0 ? pattern : std::string(1, (rand() & 1) ? '1' : '0');
+
+                    for (size_t i=0; i < bits.size(); i++) {
+                        stream += bits[i];
+                        queue.push_back(bits[i] == '1');
+
+                        bool expected = stream.size() >= (size_t) len
+                            && stream.compare(stream.size() - len, len, pattern) == 0;
+
+                        CPPUNIT_ASSERT_EQUAL(expected, matcher.push(bits[i] == '1'));
+                    }
+                }
+
+                size_t found = stream.find(pattern);
+                int expected = found == std::string::npos ? -1 : (int) found;
+
+                CPPUNIT_ASSERT_EQUAL(expected, matcher.find(queue));
+            }
+        }
+
+        /**
+         * @brief detectPattern() semantics on a plain bit vector, the
+         * left most match at or after start_pos
+         */
+        static int64_t
+        naiveDetect(const std::vector<bool> &bits, const std::string &pattern, size_t start_pos)
+        {
+            for (size_t pos=start_pos; pos + pattern.length() <= bits.size(); pos++) {
+                size_t i=0;
+
+                while (i < pattern.length() && bits[pos + i] == (pattern[i] == '1')) {
+                    i++;
+                }
+
+                if (i == pattern.length()) {
+                    return pos;
+                }
+            }
+
+            return -1;
+        }
+
+        /**
+         * @brief qa_vizsink_b::t11 checks every SyncSearch kernel against
+         * the detectPattern() semantics. Random buffers (with planted
+         * patterns at random bit phases and odd bit counts) are searched
+         * for all matches and the left most match. Every kernel up to the
+         * best one of the CPU has to be used as asked for.
+         */
+        void
+        qa_vizsink_b::t11()
+        {
+            const SyncSearch::Kernel kernels[] = {SyncSearch::SCALAR, SyncSearch::SSE2, SyncSearch::AVX2};
+            const SyncSearch::Kernel best = SyncSearch::bestKernel();
+
+            CPPUNIT_ASSERT(best >= SyncSearch::SCALAR);
+
+            srand(11);
+            for (int round=0; round < 300; round++) {
+                std::string pattern;
+                int len = 1 + rand() % 130;
+
+                for (int i=0; i < len; i++) {
+                    pattern += (rand() & 1) ? '1' : '0';
+                }
+
+                // random bits with the pattern planted here and there
+                uint64_t nr_bits = rand() % 5000;
+                std::vector<bool> bits(nr_bits);
+                std::vector<unsigned char> buf((nr_bits + 7) / 8 + 1, 0);
+
+                for (uint64_t i=0; i < nr_bits; i++) {
+                    bits[i] = rand() & 1;
+                }
+
+                for (int i=0; nr_bits > (uint64_t) len && i < 10; i++) {
+                    uint64_t pos = rand() % (nr_bits - len);
+
+                    for (int j=0; j < len; j++) {
+                        bits[pos + j] = pattern[j] == '1';
+                    }
+                }
+
+                for (uint64_t i=0; i < nr_bits; i++) {
+                    if (bits[i]) {
+                        buf[i / 8] |= 0x80 >> (i % 8);
+                    }
+                }
+
+                std::vector<uint64_t> expected;
+                int64_t pos = naiveDetect(bits, pattern, 0);
+
+                while (pos > -1) {
+                    expected.push_back(pos);
+                    pos = naiveDetect(bits, pattern, pos + 1);
+                }
+
+                for (int k=0; k < 3 && kernels[k] <= best; k++) {
+                    SyncSearch search(pattern, kernels[k]);
+                    std::vector<uint64_t> hits;
+
+                    CPPUNIT_ASSERT_EQUAL(kernels[k], search.getKernel());
+
+                    search.findAll(&buf[0], nr_bits, hits);
+                    CPPUNIT_ASSERT(expected == hits);
+
+                    uint64_t from = nr_bits ? rand() % nr_bits : 0;
+                    CPPUNIT_ASSERT_EQUAL(naiveDetect(bits, pattern, from), search.findFirst(&buf[0], nr_bits, from));
+                }
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t12 checks the raw frame stream. A 16x4
+         * image wraps after 63 bits (exported), the 64th bit changes the
+         * first pixel and the last image is exported on destruction.
+         */
+        void
+        qa_vizsink_b::t12()
+        {
+            char stream_file[64];
+            snprintf(stream_file, sizeof(stream_file), "/tmp/qa_binviz_%d.raw", (int) getpid());
+
+            const unsigned char in[] = {0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf1};
+
+            {
+                BinImg::Options options;
+                options.headless = true;
+                options.stream_file = stream_file;
+
+                BinImg img(16, 4, options);
+                img.consume(in, sizeof(in));
+            }
+
+            unsigned char out[17];
+            FILE *f = fopen(stream_file, "rb");
+            CPPUNIT_ASSERT(f != NULL);
+            size_t nr_bytes = fread(out, 1, sizeof(out), f);
+            fclose(f);
+            unlink(stream_file);
+
+            // two frames of 4 rows with 2 bytes each
+            CPPUNIT_ASSERT_EQUAL((size_t) 16, nr_bytes);
+
+            // first frame holds bits 0..62, the last pixel is the on dummy
+            for (int i=0; i < 8; i++) {
+                CPPUNIT_ASSERT_EQUAL((int) in[i], (int) out[i]);
+            }
+
+            // second frame starts over with bit 63 (on)
+            CPPUNIT_ASSERT_EQUAL(0x92, (int) out[8]);
+
+            for (int i=1; i < 8; i++) {
+                CPPUNIT_ASSERT_EQUAL((int) in[i], (int) out[8 + i]);
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t13 checks the scrollback file. 40 bits on
+         * a 8x4 image give three full lines, the line in front of the
+         * dummy pixel (7 dots), one more full line after the image
+         * wrapped and the partial line left on destruction.
+         */
+        void
+        qa_vizsink_b::t13()
+        {
+            char scrollback_file[64];
+            snprintf(scrollback_file, sizeof(scrollback_file), "/tmp/qa_binviz_%d.scroll", (int) getpid());
+
+            const unsigned char in[] = {0x12, 0x34, 0x56, 0x78, 0x9a};
+
+            {
+                BinImg::Options options;
+                options.headless = true;
+                options.scrollback_file = scrollback_file;
+
+                BinImg img(8, 4, options);
+                img.consume(in, sizeof(in));
+            }
+
+            std::vector<unsigned char> file(1024);
+            FILE *f = fopen(scrollback_file, "rb");
+            CPPUNIT_ASSERT(f != NULL);
+            file.resize(fread(&file[0], 1, file.size(), f));
+            fclose(f);
+            unlink(scrollback_file);
+
+            ScrollbackHeader header;
+            CPPUNIT_ASSERT(file.size() >= sizeof(header));
+            memcpy(&header, &file[0], sizeof(header));
+
+            CPPUNIT_ASSERT(memcmp(header.magic, "BVSCROLL", 8) == 0);
+            CPPUNIT_ASSERT_EQUAL((uint32_t) 8, header.width);
+            CPPUNIT_ASSERT_EQUAL((uint32_t) 8, header.record_size);
+            CPPUNIT_ASSERT_EQUAL((uint64_t) 6, header.nr_lines);
+
+            // the file is trimmed to the recorded lines
+            CPPUNIT_ASSERT_EQUAL(sizeof(header) + 6 * 8, file.size());
+
+            const uint32_t lengths[] = {8, 8, 8, 7, 8, 1};
+            int bit = 0;
+
+            for (int line=0; line < 6; line++) {
+                const unsigned char *record = &file[sizeof(header) + line * 8];
+                uint32_t length;
+
+                memcpy(&length, record, sizeof(length));
+                CPPUNIT_ASSERT_EQUAL(lengths[line], length);
+
+                for (uint32_t i=0; i < length; i++, bit++) {
+                    bool expected = (in[bit / 8] >> (7 - bit % 8)) & 1;
+                    bool recorded = (record[4 + i / 8] >> (7 - i % 8)) & 1;
+
+                    CPPUNIT_ASSERT_EQUAL(expected, recorded);
+                }
+            }
+
+            CPPUNIT_ASSERT_EQUAL(40, bit);
+        }
+
+        /**
+         * @brief qa_vizsink_b::t14 checks the packet index. Packets of
+         * random length (some spanning several lines) are separated by
+         * noise, none of the chunks used can form a start or end pattern.
+         * Every packet has to be read back from the scrollback as sent.
+         */
+        void
+        qa_vizsink_b::t14()
+        {
+            char scrollback_file[64];
+            char index_file[64];
+            snprintf(scrollback_file, sizeof(scrollback_file), "/tmp/qa_binviz_%d.scroll", (int) getpid());
+            snprintf(index_file, sizeof(index_file), "/tmp/qa_binviz_%d.index", (int) getpid());
+
+            const char *noise[] = {"0110", "1010"};
+            const char *payload[] = {"1001", "0101"};
+
+            std::string stream;
+            std::vector<std::string> packets;
+
+            srand(14);
+
+            for (int i=0; i < 40; i++) {
+                for (int j=rand() % 4; j >= 0; j--) {
+                    stream += noise[rand() % 2];
+                }
+
+                std::string packet = "1111";
+
+                for (int j=rand() % 12; j > 0; j--) {
+                    packet += payload[rand() % 2];
+                }
+
+                packet += "0000";
+                packets.push_back(packet);
+                stream += packet;
+            }
+
+            // whole bytes only
+            if (stream.length() % 8) {
+                stream += noise[0];
+            }
+
+            std::vector<unsigned char> in(stream.length() / 8, 0);
+
+            for (size_t i=0; i < stream.length(); i++) {
+                if (stream[i] == '1') {
+                    in[i / 8] |= 0x80 >> (i % 8);
+                }
+            }
+
+            BinImg::Options options = framing("1111", "0000");
+            options.scrollback_file = scrollback_file;
+            options.index_file = index_file;
+
+            BinImg img(16, 200, options);
+            img.consume(&in[0], in.size());
+
+            CPPUNIT_ASSERT_EQUAL((uint64_t) packets.size(), img.packets());
+
+            // read packets back in any order
+            for (int i=packets.size() - 1; i >= 0; i--) {
+                std::vector<unsigned char> bits;
+                int64_t nr_bits = img.fetchPacket(i, bits);
+
+                CPPUNIT_ASSERT_EQUAL((int64_t) packets[i].length(), nr_bits);
+
+                for (int64_t j=0; j < nr_bits; j++) {
+                    bool bit = (bits[j / 8] >> (7 - j % 8)) & 1;
+                    CPPUNIT_ASSERT_EQUAL(packets[i][j] == '1', bit);
+                }
+            }
+
+            CPPUNIT_ASSERT_EQUAL((int64_t) -1, img.fetchPacket(packets.size(), in));
+
+            img.showPacket(7);
+            delay(2);
+
+            unlink(scrollback_file);
+            unlink(index_file);
+        }
+
+        /**
+         * @brief readStream reads (and removes) a raw frame stream
+         * @param stream_file to be read
+         * @return the bytes of the stream
+         */
+        static std::vector<unsigned char>
+        readStream(const char *stream_file)
+        {
+            std::vector<unsigned char> out(1024);
+            FILE *f = fopen(stream_file, "rb");
+            CPPUNIT_ASSERT(f != NULL);
+            out.resize(fread(&out[0], 1, out.size(), f));
+            fclose(f);
+            unlink(stream_file);
+
+            return out;
+        }
+
+        /**
+         * @brief qa_vizsink_b::t15 checks the multi stream views. Both
+         * streams start their lines with 0xf0 at different offsets, the
+         * lines have to be aligned nonetheless. Interleaved, the lines of
+         * both streams alternate (framed on two threads). The diff shows
+         * where the second stream differs from the first one, the streams
+         * are fed byte by byte.
+         */
+        void
+        qa_vizsink_b::t15()
+        {
+            char stream_file[64];
+            snprintf(stream_file, sizeof(stream_file), "/tmp/qa_binviz_%d.raw", (int) getpid());
+
+            const unsigned char a[] = {0x00, 0xf0, 0x12, 0xf0, 0x34, 0xf0};
+            const unsigned char b[] = {0xaa, 0xf0, 0x13, 0xf0, 0x35, 0xf0};
+
+            std::vector<const unsigned char *> in;
+            in.push_back(a);
+            in.push_back(b);
+
+            {
+                BinImg::Options options;
+                options.headless = true;
+                options.stream_file = stream_file;
+
+                BinImg img(16, 8, options);
+                MultiFramer framer(img, 2, 16, 8, "11110000", "", "", false, MultiFramer::INTERLEAVE, 2);
+                framer.consume(in, sizeof(a));
+            }
+
+            std::vector<unsigned char> out = readStream(stream_file);
+            const unsigned char interleaved[] = {0xf0, 0x12, 0xf0, 0x13, 0xf0, 0x34, 0xf0, 0x35};
+
+            CPPUNIT_ASSERT_EQUAL((size_t) 16, out.size());
+
+            for (size_t i=0; i < sizeof(interleaved); i++) {
+                CPPUNIT_ASSERT_EQUAL((int) interleaved[i], (int) out[i]);
+            }
+
+            {
+                BinImg::Options options;
+                options.headless = true;
+                options.stream_file = stream_file;
+
+                BinImg img(16, 8, options);
+                MultiFramer framer(img, 2, 16, 8, "11110000", "", "", false, MultiFramer::DIFF);
+
+                for (size_t i=0; i < sizeof(a); i++) {
+                    framer.consume(in, 1);
+                    in[0]++;
+                    in[1]++;
+                }
+            }
+
+            out = readStream(stream_file);
+            const unsigned char diff[] = {0x00, 0x01, 0x00, 0x01, 0x00, 0x00};
+
+            CPPUNIT_ASSERT_EQUAL((size_t) 16, out.size());
+
+            for (size_t i=0; i < sizeof(diff); i++) {
+                CPPUNIT_ASSERT_EQUAL((int) diff[i], (int) out[i]);
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t16 checks the column statistics. Random
+         * lines of random length (crossing word boundaries and the point
+         * the bit sliced counters are moved to the totals) are compared
+         * to plain counting, then an image counts its lines.
+         */
+        void
+        qa_vizsink_b::t16()
+        {
+            const int width = 70;
+            ColumnStats stats(width);
+            std::vector<int> ones(width);
+            std::vector<int> present(width);
+
+            srand(16);
+
+            for (int i=0; i < 600; i++) {
+                unsigned char pixels[width];
+                int nr_pixels = rand() % (width + 1);
+
+                for (int x=0; x < width; x++) {
+                    pixels[x] = x >= nr_pixels ? 128 : rand() % 2 ? 255 : 0;
+
+                    if (x < nr_pixels) {
+                        ones[x] += pixels[x] == 255;
+                        present[x]++;
+                    }
+                }
+
+                stats.add(pixels, nr_pixels);
+            }
+
+            std::vector<double> frequency;
+            std::vector<double> entropy;
+            stats.get(frequency, entropy);
+
+            CPPUNIT_ASSERT_EQUAL((uint64_t) 600, stats.lines());
+            CPPUNIT_ASSERT_EQUAL((size_t) width, frequency.size());
+
+            for (int x=0; x < width; x++) {
+                double p = present[x] ? (double) ones[x] / present[x] : 0;
+                CPPUNIT_ASSERT(fabs(p - frequency[x]) < 1e-9);
+            }
+
+            // three lines leave the cursor, 0xf1 makes the last column vary
+            const unsigned char in[] = {0xf0, 0xf0, 0xf1};
+
+            BinImg::Options options;
+            options.headless = true;
+            options.column_stats = true;
+
+            BinImg img(8, 4, options);
+            img.consume(in, sizeof(in));
+            img.fetchColumnStats(frequency, entropy);
+
+            CPPUNIT_ASSERT_EQUAL((size_t) 8, frequency.size());
+
+            for (int x=0; x < 7; x++) {
+                CPPUNIT_ASSERT_EQUAL(x < 4 ? 1.0 : 0.0, frequency[x]);
+                CPPUNIT_ASSERT_EQUAL(0.0, entropy[x]);
+            }
+
+            CPPUNIT_ASSERT(fabs(frequency[7] - 1.0 / 3) < 1e-9);
+            CPPUNIT_ASSERT(fabs(entropy[7] - 0.918295834) < 1e-6);
+        }
+
+        /**
+         * @brief pack turns a string of 0s and 1s into bytes, padded with
+         * zeros to a whole byte
+         */
+        static std::vector<unsigned char>
+        pack(const std::string &bits)
+        {
+            std::vector<unsigned char> bytes((bits.length() + 7) / 8, 0);
+
+            for (size_t i=0; i < bits.length(); i++) {
+                if (bits[i] == '1') {
+                    bytes[i / 8] |= 0x80 >> (i % 8);
+                }
+            }
+
+            return bytes;
+        }
+
+        /**
+         * @brief qa_vizsink_b::t17 checks packet dedup. Repeats of a packet
+         * shown are counted on its row instead of being displayed (and
+         * indexed). Once its row is overwritten a packet is displayed
+         * again.
+         */
+        void
+        qa_vizsink_b::t17()
+        {
+            char index_file[64];
+            snprintf(index_file, sizeof(index_file), "/tmp/qa_binviz_%d.index", (int) getpid());
+
+            const std::string a = "111101100000";
+            const std::string b = "111110010000";
+            const std::string c = "111101010000";
+
+            {
+                std::vector<unsigned char> in = pack(a + b + a + a + c + b);
+
+                BinImg::Options options = framing("1111", "0000");
+                options.index_file = index_file;
+                options.dedup = true;
+
+                BinImg img(16, 10, options);
+                img.consume(&in[0], in.size());
+
+                CPPUNIT_ASSERT_EQUAL((uint64_t) 3, img.packets());
+                CPPUNIT_ASSERT_EQUAL((uint32_t) 2, img.repeats(0));
+                CPPUNIT_ASSERT_EQUAL((uint32_t) 1, img.repeats(1));
+                CPPUNIT_ASSERT_EQUAL((uint32_t) 0, img.repeats(2));
+                CPPUNIT_ASSERT_EQUAL((uint32_t) 0, img.repeats(3));
+                delay(2);
+            }
+
+            // c overwrites a, a overwrites b and is displayed again
+            std::vector<unsigned char> in = pack(a + b + c + a + c);
+
+            BinImg::Options options = framing("1111", "0000");
+            options.index_file = index_file;
+            options.dedup = true;
+
+            BinImg img(16, 2, options);
+            img.consume(&in[0], in.size());
+
+            CPPUNIT_ASSERT_EQUAL((uint64_t) 4, img.packets());
+            CPPUNIT_ASSERT_EQUAL((uint32_t) 1, img.repeats(0));
+            CPPUNIT_ASSERT_EQUAL((uint32_t) 0, img.repeats(1));
+
+            unlink(index_file);
+        }
+
+        /**
+         * @brief qa_vizsink_b::t18 checks tolerant matches. The sliding
+         * window matcher is compared to a plain Hamming distance of the
+         * stream tail (patterns planted with bit errors), then a start
+         * pattern with two bit errors has to start a line as well.
+         */
+        void
+        qa_vizsink_b::t18()
+        {
+            srand(18);
+
+            for (int len=4; len <= 130; len += 7) {
+                std::string pattern;
+                std::string stream;
+                size_t max_errors = 1 + rand() % (len / 2 - 1);
+
+                for (int i=0; i < len; i++) {
+                    pattern += (rand() & 1) ? '1' : '0';
+                }
+
+                PatternMatcher matcher(pattern, max_errors);
+                CPPUNIT_ASSERT_EQUAL(max_errors, matcher.errors());
+
+                while (stream.size() < 2000) {
+
+                    // plant the pattern with up to max_errors + 1 flips now and then
+                    std::string bits = rand() % 8 == 0 ? pattern : std::string(1, (rand() & 1) ? '1' : '0');
+
+                    if (bits.size() > 1) {
+                        for (int i=rand() % (max_errors + 2); i > 0; i--) {
+                            char &bit = bits[rand() % len];
+                            bit = bit == '1' ? '0' : '1';
+                        }
+                    }
+
+                    for (size_t i=0; i < bits.size(); i++) {
+                        stream += bits[i];
+
+                        size_t distance = 0;
+
+                        if (stream.size() >= (size_t) len) {
+                            for (int j=0; j < len; j++) {
+                                distance += stream[stream.size() - len + j] != pattern[j];
+                            }
+                        }
+
+                        bool expected = stream.size() >= (size_t) len && distance <= max_errors;
+
+                        CPPUNIT_ASSERT_EQUAL(expected, matcher.push(bits[i] == '1'));
+                    }
+                }
+            }
+
+            // the first start pattern has two bit errors
+            const std::string start = "1100101011110000";
+            std::vector<unsigned char> in = pack("1110101011010000" "0000000000000000" + start + "0000000000000000");
+
+            for (int max_errors=0; max_errors <= 2; max_errors += 2) {
+                Framer framer(start, "", "", false, false, max_errors);
+                framer.consume(&in[0], in.size());
+
+                size_t nr_wraps = 0;
+
+                for (size_t i=0; i < framer.getEvents().size(); i++) {
+                    nr_wraps += framer.getEvents()[i].type == FrameEvent::WRAP;
+                }
+
+                CPPUNIT_ASSERT_EQUAL((size_t) (max_errors ? 2 : 1), nr_wraps);
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t19 checks several start patterns. The
+         * automaton is compared to matching every pattern against the
+         * stream tail (the longest match wins), then every line has to be
+         * tagged with the start pattern it starts with.
+         */
+        void
+        qa_vizsink_b::t19()
+        {
+            srand(19);
+
+            for (int run=0; run < 50; run++) {
+                std::vector<std::string> patterns(1 + rand() % 8);
+                std::string stream;
+
+                for (size_t i=0; i < patterns.size(); i++) {
+                    for (int len=1 + rand() % 12; len > 0; len--) {
+                        patterns[i] += (rand() & 1) ? '1' : '0';
+                    }
+                }
+
+                PatternSet set(patterns);
+                CPPUNIT_ASSERT_EQUAL(patterns.size(), set.size());
+
+                for (int i=0; i < 2000; i++) {
+                    bool bit = rand() & 1;
+                    stream += bit ? '1' : '0';
+
+                    int expected = -1;
+
+                    for (size_t j=0; j < patterns.size(); j++) {
+                        size_t len = patterns[j].size();
+
+                        if (stream.size() >= len && stream.compare(stream.size() - len, len, patterns[j]) == 0 && (expected < 0 || len > patterns[expected].size())) {
+                            expected = j;
+                        }
+                    }
+
+                    CPPUNIT_ASSERT_EQUAL(expected, set.push(bit));
+                }
+            }
+
+            // lines start with the first, third and second start pattern
+            const std::string start = "11110000,1100110011,10101010";
+            std::vector<unsigned char> in = pack("0000" "11110000" "000111" "10101010" "000111" "1100110011" "000111");
+            const int tags[] = { 0, 2, 1 };
+
+            for (int end=0; end < 2; end++) {
+                Framer framer(start, end ? "000111" : "", "", false);
+                framer.consume(&in[0], in.size());
+
+                const std::vector<FrameEvent> &events = framer.getEvents();
+                size_t nr_starts = 0;
+
+                for (size_t i=0; i < events.size(); i++) {
+                    if (events[i].type == (end ? FrameEvent::PACKET_START : FrameEvent::WRAP)) {
+                        CPPUNIT_ASSERT(nr_starts < 3);
+                        CPPUNIT_ASSERT_EQUAL(tags[nr_starts], events[i].tag);
+                        nr_starts++;
+                    }
+                }
+
+                CPPUNIT_ASSERT_EQUAL((size_t) 3, nr_starts);
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t20 checks framing by marks (stream tags).
+         * Lines started by marks have to equal lines started by a start
+         * pattern at the same positions, packets framed by marks drop the
+         * bits in between and hashed packets have to match unhashed ones.
+         */
+        void
+        qa_vizsink_b::t20()
+        {
+            const std::string start = "11110000";
+            std::vector<unsigned char> in = pack("10100101" "11110000" "00111100" "11110000" "11110000" "01010101");
+
+            // start marks in front of each start pattern
+            BinImg::Options pattern_options = framing(start);
+            pattern_options.headless = true;
+
+            BinImg::Options marks_options;
+            marks_options.headless = true;
+            marks_options.start_marks = true;
+
+            BinImg by_pattern(32, 8, pattern_options);
+            BinImg by_marks(32, 8, marks_options);
+
+            by_pattern.consume(&in[0], in.size());
+            by_pattern.flush();
+
+            for (size_t i=0; i < in.size(); i++) {
+                if (in[i] == 0xf0) {
+                    by_marks.markStart();
+                }
+
+                by_marks.consume(&in[i], 1);
+            }
+
+            by_marks.flush();
+
+            for (int y=0; y < 8; y++) {
+                for (int x=0; x < 32; x++) {
+                    CPPUNIT_ASSERT_EQUAL(by_pattern.getPixel(x, y), by_marks.getPixel(x, y));
+                }
+            }
+
+            // packets from start to end mark, ends before starts
+            for (int hash=0; hash < 2; hash++) {
+                Framer framer("", "", "", false, hash, 0, 0, true, true);
+
+                framer.consume(in[0]);
+                framer.markStart();
+                framer.consume(&in[1], 2);
+                framer.markStart();
+                framer.markEnd();
+                framer.consume(in[3]);
+                framer.markStart();
+                framer.consume(&in[4], 2);
+                framer.markEnd();
+                framer.flush();
+
+                CPPUNIT_ASSERT(framer.framesPackets());
+                CPPUNIT_ASSERT_EQUAL((size_t) 32, framer.bits().size());
+
+                const std::vector<FrameEvent> &events = framer.getEvents();
+                CPPUNIT_ASSERT_EQUAL((size_t) 6, events.size());
+                CPPUNIT_ASSERT_EQUAL(FrameEvent::PACKET_START, events[0].type);
+                CPPUNIT_ASSERT_EQUAL((uint64_t) 8, events[0].offset);
+                CPPUNIT_ASSERT_EQUAL((uint32_t) 16, events[1].length);
+                CPPUNIT_ASSERT_EQUAL((uint64_t) 32, events[3].offset);
+                CPPUNIT_ASSERT_EQUAL((uint32_t) 16, events[4].length);
+                CPPUNIT_ASSERT_EQUAL(hash == 1, events[0].hash != 0);
+
+                for (size_t i=0; i < 32; i++) {
+                    CPPUNIT_ASSERT_EQUAL(framer.bits().at(i), (bool) ((in[1 + i / 8 + (i >= 16 ? 1 : 0)] >> (7 - i % 8)) & 1));
+                }
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t21 checks the input formats. Random bits
+         * are fed packed most and least significant bit first and
+         * unpacked in random chunks, with and without patterns (and
+         * skipped zero bytes), the framed bits and events have to equal
+         * those of the same bits fed packed most significant bit first.
+         */
+        void
+        qa_vizsink_b::t21()
+        {
+            srand(21);
+
+            for (int run=0; run < 40; run++) {
+                std::vector<unsigned char> msb(1 + rand() % 300);
+                std::vector<unsigned char> lsb(msb.size());
+                std::vector<unsigned char> unpacked;
+
+                for (size_t i=0; i < msb.size(); i++) {
+                    msb[i] = rand() % 4 ? rand() & 0xff : 0;
+
+                    for (int j=0; j < 8; j++) {
+                        bool bit = (msb[i] >> (7 - j)) & 1;
+
+                        lsb[i] |= bit << j;
+
+                        // only the lowest bit counts
+                        unpacked.push_back((rand() & 0xfe) | bit);
+                    }
+                }
+
+                const std::string starts[] = { "", "1011", "" };
+                const std::string ends[] = { "", "", "0110" };
+                int pattern = run % 3;
+                bool skip = run % 2;
+
+                Framer reference(starts[pattern], ends[pattern], "", skip);
+                reference.consume(&msb[0], msb.size());
+                reference.flush();
+
+                for (int format=BitPacker::PACKED_LSB; format <= BitPacker::UNPACKED; format++) {
+                    const std::vector<unsigned char> &in = format == BitPacker::UNPACKED ? unpacked : lsb;
+                    Framer framer(starts[pattern], ends[pattern], "", skip, false, 0, 0, false, false, (BitPacker::Format) format);
+                    BitQueue bits;
+                    std::vector<FrameEvent> events;
+
+                    for (size_t i=0; i < in.size(); ) {
+                        size_t len = std::min(in.size() - i, (size_t) (1 + rand() % 150));
+
+                        framer.consume(&in[i], len);
+                        i += len;
+
+                        // events are relative to the bits since clear()
+                        for (size_t j=0; j < framer.getEvents().size(); j++) {
+                            events.push_back(framer.getEvents()[j]);
+                            events.back().pos += bits.size();
+                        }
+
+                        for (size_t j=0; j < framer.bits().size(); j++) {
+                            bits.push_back(framer.bits().at(j));
+                        }
+
+                        framer.clear();
+                    }
+
+                    framer.flush();
+
+                    for (size_t j=0; j < framer.getEvents().size(); j++) {
+                        events.push_back(framer.getEvents()[j]);
+                        events.back().pos += bits.size();
+                    }
+
+                    for (size_t j=0; j < framer.bits().size(); j++) {
+                        bits.push_back(framer.bits().at(j));
+                    }
+
+                    CPPUNIT_ASSERT_EQUAL(reference.bits().size(), bits.size());
+                    CPPUNIT_ASSERT_EQUAL(reference.getEvents().size(), events.size());
+
+                    for (size_t j=0; j < bits.size(); j++) {
+                        CPPUNIT_ASSERT_EQUAL(reference.bits().at(j), bits.at(j));
+                    }
+
+                    for (size_t j=0; j < events.size(); j++) {
+                        CPPUNIT_ASSERT_EQUAL(reference.getEvents()[j].type, events[j].type);
+                        CPPUNIT_ASSERT_EQUAL(reference.getEvents()[j].pos, events[j].pos);
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t22 checks the filter stage. Buffers with
+         * long zero runs (found 16 bytes at a time) are filtered in random
+         * chunks and compared to a plain model: zero bytes are skipped,
+         * the drop pattern is removed from the end of a bit string as soon
+         * as it is completed and all but the last drop length - 1 bits
+         * are passed on after each byte.
+         */
+        void
+        qa_vizsink_b::t22()
+        {
+            srand(22);
+
+            for (int run=0; run < 60; run++) {
+                std::vector<unsigned char> in;
+                std::string drop;
+
+                while (in.size() < 2000) {
+                    int len = 1 + rand() % 40;
+                    bool zero = rand() % 2;
+
+                    for (int i=0; i < len; i++) {
+                        in.push_back(zero ? 0 : (rand() % 3 ? rand() & 0xff : 0xa5));
+                    }
+                }
+
+                for (int len=run % 3 ? 2 + rand() % 10 : 0; len > 0; len--) {
+                    drop += (rand() & 1) ? '1' : '0';
+                }
+
+                bool skip = run % 4 != 0;
+
+                // plain model
+                std::string expected;
+                std::string pending;
+
+                for (size_t i=0; i < in.size(); i++) {
+                    if (skip && in[i] == 0) {
+                        continue;
+                    }
+
+                    for (int j=7; j >= 0; j--) {
+                        pending += ((in[i] >> j) & 1) ? '1' : '0';
+
+                        if (!drop.empty() && pending.size() >= drop.size() && pending.compare(pending.size() - drop.size(), drop.size(), drop) == 0) {
+                            pending.erase(pending.size() - drop.size());
+                        }
+                    }
+
+                    size_t keep = drop.empty() ? 0 : drop.size() - 1;
+
+                    if (pending.size() > keep) {
+                        expected += pending.substr(0, pending.size() - keep);
+                        pending.erase(0, pending.size() - keep);
+                    }
+                }
+
+                expected += pending;
+
+                BitFilter filter(drop, skip);
+                BitQueue out;
+
+                CPPUNIT_ASSERT_EQUAL(drop.empty() && !skip, filter.empty());
+
+                for (size_t i=0; i < in.size(); ) {
+                    size_t len = std::min(in.size() - i, (size_t) (rand() % 200));
+
+                    filter.push(&in[i], len, out);
+                    i += len;
+                }
+
+                filter.flush(out);
+
+                CPPUNIT_ASSERT_EQUAL(expected.size(), out.size());
+
+                for (size_t i=0; i < out.size(); i++) {
+                    CPPUNIT_ASSERT_EQUAL(expected[i] == '1', out.at(i));
+                }
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t23 checks the hand-off ring. Bits and events
+         * have to come out as pushed, a full ring drops the oldest entries
+         * (or every other line and the newest entries when decimating) and
+         * marks the gap. An image fed through the ring by the render thread
+         * has to equal an image placing bits right away.
+         */
+        void
+        qa_vizsink_b::t23()
+        {
+            srand(23);
+
+            BitQueue bits;
+            std::vector<FrameEvent> events;
+
+            for (int i=0; i < 3000; i++) {
+                bits.push_back(rand() & 1);
+
+                if (rand() % 200 == 0) {
+                    FrameEvent event = FrameEvent();
+                    event.type = (FrameEvent::Type) (rand() % 3);
+                    event.pos = bits.size();
+                    event.offset = rand();
+                    event.length = rand();
+                    event.hash = rand();
+                    event.tag = rand() % 4;
+                    events.push_back(event);
+                }
+            }
+
+            // everything fits
+            {
+                HandoffRing ring(64 * HandoffRing::CHUNK_BITS);
+                BitQueue out;
+                std::vector<FrameEvent> out_events;
+
+                ring.push(bits, events);
+                CPPUNIT_ASSERT(!ring.empty());
+                CPPUNIT_ASSERT(ring.pop(out, out_events) > 0);
+                CPPUNIT_ASSERT(ring.empty());
+                CPPUNIT_ASSERT_EQUAL((uint64_t) 0, ring.dropped());
+
+                CPPUNIT_ASSERT_EQUAL(bits.size(), out.size());
+                CPPUNIT_ASSERT_EQUAL(events.size(), out_events.size());
+
+                for (size_t i=0; i < bits.size(); i++) {
+                    CPPUNIT_ASSERT_EQUAL(bits.at(i), out.at(i));
+                }
+
+                for (size_t i=0; i < events.size(); i++) {
+                    CPPUNIT_ASSERT_EQUAL(events[i].type, out_events[i].type);
+                    CPPUNIT_ASSERT_EQUAL(events[i].pos, out_events[i].pos);
+                    CPPUNIT_ASSERT_EQUAL(events[i].offset, out_events[i].offset);
+                    CPPUNIT_ASSERT_EQUAL(events[i].length, out_events[i].length);
+                    CPPUNIT_ASSERT_EQUAL(events[i].hash, out_events[i].hash);
+                    CPPUNIT_ASSERT_EQUAL(events[i].tag, out_events[i].tag);
+                }
+            }
+
+            // the last two chunks are left behind a gap
+            {
+                HandoffRing ring(0, HandoffRing::DROP_OLDEST);
+                BitQueue out;
+                std::vector<FrameEvent> out_events;
+
+                CPPUNIT_ASSERT_EQUAL(2 * HandoffRing::CHUNK_BITS, ring.capacity());
+
+                for (int i=0; i < 10; i++) {
+                    BitQueue chunk;
+
+                    for (size_t j=0; j < HandoffRing::CHUNK_BITS; j++) {
+                        chunk.push_back((j + i) % 3 == 0);
+                    }
+
+                    ring.push(chunk, std::vector<FrameEvent>());
+                }
+
+                CPPUNIT_ASSERT_EQUAL((uint64_t) 8, ring.dropped());
+                CPPUNIT_ASSERT_EQUAL((size_t) 2, ring.pop(out, out_events));
+                CPPUNIT_ASSERT_EQUAL((size_t) 1, out_events.size());
+                CPPUNIT_ASSERT_EQUAL(FrameEvent::GAP, out_events[0].type);
+                CPPUNIT_ASSERT_EQUAL((size_t) 0, out_events[0].pos);
+                CPPUNIT_ASSERT_EQUAL(2 * HandoffRing::CHUNK_BITS, out.size());
+
+                for (size_t j=0; j < out.size(); j++) {
+                    CPPUNIT_ASSERT_EQUAL((j % HandoffRing::CHUNK_BITS + 8 + j / HandoffRing::CHUNK_BITS) % 3 == 0, out.at(j));
+                }
+            }
+
+            // lines of 64 bits and a wrap (2 entries each), numbered by
+            // their first byte. Lines 0 to 2 fill more than half of the
+            // ring, 3 is decimated, 4 fills the ring, 5 is decimated, 6 is
+            // dropped (full) and so on. Line 10 comes after a gap.
+            {
+                HandoffRing ring(8 * HandoffRing::CHUNK_BITS, HandoffRing::DECIMATE);
+                BitQueue out;
+                std::vector<FrameEvent> out_events;
+                FrameEvent wrap = FrameEvent();
+                wrap.type = FrameEvent::WRAP;
+                wrap.pos = 64;
+
+                for (int i=0; i < 11; i++) {
+                    BitQueue line;
+                    line.push_bits((uint64_t) i << 56, 64);
+
+                    ring.push(line, std::vector<FrameEvent>(1, wrap));
+
+                    if (i == 9) {
+                        CPPUNIT_ASSERT_EQUAL((size_t) 8, ring.pop(out, out_events));
+                    }
+                }
+
+                CPPUNIT_ASSERT(ring.dropped() > 0);
+                CPPUNIT_ASSERT_EQUAL((size_t) 2, ring.pop(out, out_events));
+                CPPUNIT_ASSERT_EQUAL((size_t) 5 * 64, out.size());
+                CPPUNIT_ASSERT_EQUAL((size_t) 6, out_events.size());
+                CPPUNIT_ASSERT_EQUAL(FrameEvent::GAP, out_events[4].type);
+                CPPUNIT_ASSERT_EQUAL((size_t) 4 * 64, out_events[4].pos);
+
+                const uint64_t lines[] = {0, 1, 2, 4, 10};
+
+                for (int i=0; i < 5; i++) {
+                    CPPUNIT_ASSERT_EQUAL(lines[i], out.word(64 * i) >> 56);
+                }
+            }
+
+            // repeated packets of random bits in random chunks
+            std::vector<std::string> packets;
+
+            for (int i=0; i < 5; i++) {
+                std::string packet = "1111";
+
+                for (int j=0; j < 40; j++) {
+                    packet += (rand() % 3) ? "01" : "10";
+                }
+
+                packets.push_back(packet + "0000");
+            }
+
+            std::string stream;
+
+            for (int i=0; i < 400; i++) {
+                stream += packets[rand() % packets.size()] + "0101";
+            }
+
+            std::vector<unsigned char> in = pack(stream);
+
+            for (int overflow=HandoffRing::BLOCK; overflow <= HandoffRing::DECIMATE; overflow++) {
+                BinImg::Options options = framing("1111", "0000");
+                options.frame_rate = 1000;
+                options.headless = true;
+                options.dedup = true;
+
+                BinImg direct(48, 40, options);
+
+                options.handoff_bits = overflow == HandoffRing::BLOCK ? 2048 : 1 << 23;
+                options.overflow = (HandoffRing::Overflow) overflow;
+
+                BinImg handed(48, 40, options);
+
+                for (size_t i=0; i < in.size(); ) {
+                    size_t len = std::min(in.size() - i, (size_t) (rand() % 50));
+
+                    direct.consume(&in[i], len);
+                    handed.consume(&in[i], len);
+                    i += len;
+                }
+
+                direct.flush();
+                handed.flush();
+
+                CPPUNIT_ASSERT_EQUAL((uint64_t) 0, handed.dropped());
+
+                for (int y=0; y < 40; y++) {
+                    CPPUNIT_ASSERT_EQUAL(direct.repeats(y), handed.repeats(y));
+
+                    for (int x=0; x < 48; x++) {
+                        CPPUNIT_ASSERT_EQUAL(direct.getPixel(x, y), handed.getPixel(x, y));
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t24 checks the raster of every combination of
+         * start, end and drop pattern and skipped zero bytes against golden
+         * rows. Rows not listed are clear, the cursor is behind the last
+         * row listed.
+         */
+        void
+        qa_vizsink_b::t24()
+        {
+            const unsigned char in[] = {0xd3, 0x00, 0x36, 0xe9, 0x00, 0x00, 0xb4, 0x3d, 0x00, 0x1b, 0x65};
+
+            // combination bits: 1 start, 2 end, 4 drop pattern, 8 skip
+            // zero bytes. The drop pattern does not apply with both, start
+            // and end pattern.
+            const char *golden[16][8] = {
+                {"110100110000000000110110111010010000000000000000", "1011010000111101000000000001101101100101", NULL},
+                {"", "110100110000000000", "1101101", "1101001000000000000000010", "1101000011", "110100000000000", "1101101100101", NULL},
+                {"11010011", "000000000011", "0110111010010000000000000000101101000011", "11010000000000011", "01101100101", NULL},
+                {"11010011", "110110111010010000000000000000101101000011", "11010000000000011", "1101100101", NULL},
+                {"110100110000000000110110010010000000000000000101", "1010000101000000000001101101100101", NULL},
+                {"", "110100110000000000", "11011001001000000000000000010", "1101000010100000000000", "1101101100101", NULL},
+                {"11010011", "000000000011", "011001001000000000000000010110100001010000000000", "011", "01101100101", NULL},
+                {"11010011", "110110111010010000000000000000101101000011", "11010000000000011", "1101100101", NULL},
+                {"110100110011011011101001101101000011110100011011", "01100101", NULL},
+                {"", "1101001100", "1101101", "110100", "1101101000011", "1101000", "1101101100101", NULL},
+                {"11010011", "0011", "0110111010011", "01101000011", "110100011", "01101100101", NULL},
+                {"11010011", "110110111010011", "1101000011", "110100011", "1101100101", NULL},
+                {"110100110011011001001101101000010100011011011001", "01", NULL},
+                {"", "1101001100", "1101100100", "11011010000101000", "1101101100101", NULL},
+                {"11010011", "0011", "0110010011", "01101000010100011", "01101100101", NULL},
+                {"11010011", "110110111010011", "1101000011", "110100011", "1101100101", NULL},
+            };
+
+            for (int combination=0; combination < 16; combination++) {
+                BinImg::Options options = framing(combination & 1 ? "1101" : "", combination & 2 ? "0011" : "", combination & 4 ? "111" : "", combination & 8);
+                options.headless = true;
+
+                BinImg img(48, 12, options);
+                img.consume(in, sizeof(in));
+                img.flush();
+
+                int nr_rows = 0;
+
+                for (; golden[combination][nr_rows]; nr_rows++) {
+                    CPPUNIT_ASSERT_EQUAL(std::string(golden[combination][nr_rows]), raster(img, nr_rows));
+                }
+
+                // the last row holds the dummy pixels
+                for (int y=nr_rows; y < 11; y++) {
+                    CPPUNIT_ASSERT_EQUAL(std::string(""), raster(img, y));
+                }
+
+                CPPUNIT_ASSERT_EQUAL((nr_rows - 1) * 48 + (int) strlen(golden[combination][nr_rows - 1]), img.getPosition());
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t25 checks the packed raster: dots set and
+         * cleared are read back and expanded to the shade of their row,
+         * off or gray (rows not a multiple of 8 or 64 dots wide)
+         */
+        void
+        qa_vizsink_b::t25()
+        {
+            BitRaster raster(70, 3);
+            std::vector<unsigned char> pixels(70 * 3);
+
+            for (int x=0; x < 70; x++) {
+                raster.set(x, 0, x % 3 ? 0 : 255);
+            }
+
+            raster.set(69, 1, 208);
+            raster.set(3, 1, 0);
+            raster.set(3, 1, 128);
+            raster.set(70, 1, 255);
+            raster.set(0, 3, 255);
+
+            raster.expand(&pixels[0]);
+
+            for (int x=0; x < 70; x++) {
+                unsigned char row0 = x % 3 ? 0 : 255;
+                unsigned char row1 = x == 69 ? 208 : 128;
+
+                CPPUNIT_ASSERT_EQUAL(row0, raster.get(x, 0));
+                CPPUNIT_ASSERT_EQUAL(row0, pixels[x]);
+                CPPUNIT_ASSERT_EQUAL(row1, raster.get(x, 1));
+                CPPUNIT_ASSERT_EQUAL(row1, pixels[70 + x]);
+                CPPUNIT_ASSERT_EQUAL((unsigned char) 128, pixels[140 + x]);
+            }
+
+            raster.clear();
+            raster.expand(1, &pixels[0]);
+
+            CPPUNIT_ASSERT_EQUAL((unsigned char) 128, raster.get(0, 0));
+            CPPUNIT_ASSERT_EQUAL((unsigned char) 128, pixels[69]);
+        }
+
+        /**
+         * @brief qa_vizsink_b::t26 checks that lines displayed as a whole
+         * (spans of rows) match lines displayed bit by bit, for lines
+         * shorter and longer than a row and several wraps of the image
+         */
+        void
+        qa_vizsink_b::t26()
+        {
+            srand(26);
+
+            for (int width=1; width < 140; width += 23) {
+                BinImg::Options options;
+                options.headless = true;
+
+                BinImg spans(width + 1, 7, options);
+                BinImg dots(width + 1, 7, options);
+
+                for (int i=0; i < 60; i++) {
+                    BitQueue line;
+                    int nr_bits = rand() % (3 * width);
+
+                    for (int j=0; j < nr_bits; j++) {
+                        bool bit = rand() & 1;
+
+                        line.push_back(bit);
+                        dots.set(bit);
+                    }
+
+                    spans.putLine(line);
+
+                    // a line filling the row wrapped already
+                    if (nr_bits == 0 || dots.getPosition() % (width + 1) != 0) {
+                        dots.putLine(BitQueue());
+                    }
+
+                    CPPUNIT_ASSERT_EQUAL(dots.getPosition(), spans.getPosition());
+                }
+
+                for (int y=0; y < 7; y++) {
+                    CPPUNIT_ASSERT_EQUAL(raster(dots, y), raster(spans, y));
+                }
+            }
+        }
+
+        /**
+         * @brief qa_vizsink_b::t27 checks the zoomed out rows of the
+         * density pyramid against the shares of ones counted dot by dot,
+         * after the raster was built and after parts of it changed
+         * (counted again incrementally)
+         */
+        void
+        qa_vizsink_b::t27()
+        {
+            srand(27);
+
+            const int width = 300;
+            const int height = 77;
+
+            BitRaster raster(width, height);
+            DensityPyramid pyramid(width, height);
+            std::vector<unsigned char> pixels(width);
+
+            for (int round=0; round < 3; round++) {
+                int top = round ? rand() % height : 0;
+                int bottom = round ? top + 1 + rand() % (height - top) : height;
+
+                for (int y=top; y < bottom; y++) {
+                    for (int x=0; x < width; x++) {
+                        int dot = rand() % 5;
+
+                        // some dots are left gray
+                        raster.set(x, y, dot == 0 ? 128 : dot < 3 ? 0 : 255);
+                    }
+                }
+
+                pyramid.invalidate(top, bottom);
+                pyramid.update(raster);
+
+                for (int level=1; level <= DensityPyramid::MAX_LEVEL; level++) {
+                    int size = 1 << level;
+
+                    for (int y=0; y < (height + size - 1) / size; y++) {
+                        pyramid.draw(raster, level, y, &pixels[0]);
+
+                        for (int x=0; x < (width + size - 1) / size; x++) {
+                            unsigned int on = 0;
+                            unsigned int drawn = 0;
+
+                            for (int j=y * size; j < height && j < (y + 1) * size; j++) {
+                                for (int i=x * size; i < width && i < (x + 1) * size; i++) {
+                                    on += raster.get(i, j) == 255;
+                                    drawn += raster.get(i, j) != 128;
+                                }
+                            }
+
+                            unsigned char expected = drawn ? (on * 255 + drawn / 2) / drawn : 128;
+
+                            CPPUNIT_ASSERT_EQUAL((int) expected, (int) pixels[x]);
+                        }
+                    }
+                }
+            }
+        }
     } /* namespace binviz */
 } /* namespace gr */
@@ -39,6 +39,26 @@ namespace gr {
       CPPUNIT_TEST(t5);
       CPPUNIT_TEST(t6);
       CPPUNIT_TEST(t7);
+      CPPUNIT_TEST(t8);
+      CPPUNIT_TEST(t9);
+      CPPUNIT_TEST(t10);
+      CPPUNIT_TEST(t11);
+      CPPUNIT_TEST(t12);
+      CPPUNIT_TEST(t13);
+      CPPUNIT_TEST(t14);
+      CPPUNIT_TEST(t15);
+      CPPUNIT_TEST(t16);
+      CPPUNIT_TEST(t17);
+      CPPUNIT_TEST(t18);
+      CPPUNIT_TEST(t19);
+      CPPUNIT_TEST(t20);
+      CPPUNIT_TEST(t21);
+      CPPUNIT_TEST(t22);
+      CPPUNIT_TEST(t23);
+      CPPUNIT_TEST(t24);
+      CPPUNIT_TEST(t25);
+      CPPUNIT_TEST(t26);
+      CPPUNIT_TEST(t27);
       CPPUNIT_TEST_SUITE_END();
 
     private:
@@ -49,6 +69,26 @@ namespace gr {
       void t5();
       void t6();
       void t7();
+      void t8();
+      void t9();
+      void t10();
+      void t11();
+      void t12();
+      void t13();
+      void t14();
+      void t15();
+      void t16();
+      void t17();
+      void t18();
+      void t19();
+      void t20();
+      void t21();
+      void t22();
+      void t23();
+      void t24();
+      void t25();
+      void t26();
+      void t27();
     };
 
   } /* namespace binviz */
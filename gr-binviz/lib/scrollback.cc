@@ -0,0 +1,141 @@
+#include "scrollback.h"
+#include <cstring>
+#include <iostream>
+
+const char Scrollback::MAGIC[] = "BVSCROLL";
+const uint32_t Scrollback::VERSION = 1;
+
+/**
+ * @brief Scrollback::Scrollback creates (or truncates) a scrollback file,
+ * check isOpen() for success
+ * @param path of the scrollback file
+ * @param width of the lines (number of dots)
+ */
+Scrollback::Scrollback(const std::string &path, int width)
+    :path(path), width(width), nr_lines(0)
+{
+    // length of the line and its dots, padded to keep lengths aligned
+    record_size = sizeof(uint32_t) + (width + 7) / 8;
+    record_size = (record_size + 3) & ~(size_t) 3;
+
+    if (!file.create(path)) {
+        std::cerr << "BinViz: creating scrollback " << path << " failed" << std::endl;
+        return;
+    }
+
+    ScrollbackHeader *header = (ScrollbackHeader *) file.data();
+
+    memcpy(header->magic, MAGIC, sizeof(header->magic));
+    header->version = VERSION;
+    header->width = width;
+    header->record_size = record_size;
+    header->reserved = 0;
+    header->nr_lines = 0;
+}
+
+/**
+ * @brief Scrollback::~Scrollback trims the file to the lines in use
+ */
+Scrollback::~Scrollback()
+{
+    if (file.isOpen()) {
+        file.close(sizeof(ScrollbackHeader) + nr_lines * record_size);
+    }
+}
+
+/**
+ * @brief Scrollback::isOpen
+ * @return true if lines are recorded
+ */
+bool
+Scrollback::isOpen() const
+{
+    return file.isOpen();
+}
+
+/**
+ * @brief Scrollback::lines
+ * @return the number of lines recorded so far, 0 if the file is closed
+ */
+uint64_t
+Scrollback::lines() const
+{
+    return file.isOpen() ? nr_lines : 0;
+}
+
+/**
+ * @brief Scrollback::record
+ * @param line number of the line (0 is the oldest line)
+ * @return the record of the line, valid until the next append()
+ */
+unsigned char *
+Scrollback::record(uint64_t line) const
+{
+    return file.data() + sizeof(ScrollbackHeader) + line * record_size;
+}
+
+/**
+ * @brief Scrollback::append records a line. On errors (e.g. disk full) the
+ * file is closed and no further lines are recorded.
+ * @param pixels of the line, pixels brighter than gray (cleared) are on
+ * @param nr_pixels number of dots of the line, at most the width
+ */
+void
+Scrollback::append(const unsigned char *pixels, uint32_t nr_pixels)
+{
+    if (!file.isOpen()) {
+        return;
+    }
+
+    if (!file.reserve(sizeof(ScrollbackHeader) + (nr_lines + 1) * record_size)) {
+        std::cerr << "BinViz: growing scrollback " << path << " failed, no further lines are recorded" << std::endl;
+        file.close(sizeof(ScrollbackHeader) + nr_lines * record_size);
+        return;
+    }
+
+    if (nr_pixels > (uint32_t) width) {
+        nr_pixels = width;
+    }
+
+    unsigned char *line = record(nr_lines);
+    unsigned char *bits = line + sizeof(uint32_t);
+
+    memcpy(line, &nr_pixels, sizeof(uint32_t));
+    memset(bits, 0, record_size - sizeof(uint32_t));
+
+    for (uint32_t i=0; i < nr_pixels; i++) {
+        if (pixels[i] > 128) {
+            bits[i / 8] |= 0x80 >> (i % 8);
+        }
+    }
+
+    nr_lines++;
+    ((ScrollbackHeader *) file.data())->nr_lines = nr_lines;
+}
+
+/**
+ * @brief Scrollback::length
+ * @param line number of the line (0 is the oldest line, check lines())
+ * @return the number of dots of the line
+ */
+uint32_t
+Scrollback::length(uint64_t line) const
+{
+    uint32_t nr_pixels;
+
+    memcpy(&nr_pixels, record(line), sizeof(uint32_t));
+
+    return nr_pixels;
+}
+
+/**
+ * @brief Scrollback::bits
+ * @param line number of the line (0 is the oldest line, check lines())
+ * @return the dots of the line packed at 1 bit per dot, most significant
+ * bit first, valid until the next append()
+ */
+const unsigned char *
+Scrollback::bits(uint64_t line) const
+{
+    return record(line) + sizeof(uint32_t);
+}
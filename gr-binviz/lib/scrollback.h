@@ -0,0 +1,58 @@
+#ifndef SCROLLBACK_H
+#define SCROLLBACK_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include "mappedfile.h"
+
+/**
+ * @brief The ScrollbackHeader struct starts a scrollback file. It is
+ * followed by nr_lines records of record_size bytes each: the number of
+ * dots of the line (uint32_t) followed by the dots packed at 1 bit per
+ * dot, most significant bit first (1 is on). All values are stored in
+ * host byte order.
+ */
+struct ScrollbackHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t record_size;
+    uint32_t reserved;
+    uint64_t nr_lines;
+};
+
+/**
+ * @brief The Scrollback class keeps every line that was displayed in a
+ * memory mapped file. Records have a fixed size, so appending a line and
+ * accessing line n are O(1) and only the lines being looked at have to be
+ * paged in.
+ */
+class Scrollback
+{
+    private:
+        static const char MAGIC[];
+        static const uint32_t VERSION;
+
+        MappedFile file;
+        std::string path;
+        int width;
+        size_t record_size;
+        uint64_t nr_lines;
+
+        unsigned char *record(uint64_t line) const;
+
+    public:
+        Scrollback(const std::string &path, int width);
+        ~Scrollback();
+
+        bool isOpen() const;
+        uint64_t lines() const;
+
+        void append(const unsigned char *pixels, uint32_t nr_pixels);
+        uint32_t length(uint64_t line) const;
+        const unsigned char *bits(uint64_t line) const;
+};
+
+#endif // SCROLLBACK_H
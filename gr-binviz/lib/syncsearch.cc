@@ -0,0 +1,468 @@
+#include "syncsearch.h"
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SYNCSEARCH_X86
+#include <immintrin.h>
+#endif
+
+// bits searched per round by findFirst(), the first round is short and
+// each round doubles up to FIND_FIRST_CHUNK
+static const uint64_t FIND_FIRST_CHUNK = 1 << 20;
+static const uint64_t FIND_FIRST_MIN_CHUNK = 1 << 12;
+
+/**
+ * @brief SyncSearch::SyncSearch compiles a pattern into per phase anchors
+ * @param pattern composed of '0' and '1' only (check before), an empty
+ * pattern never matches
+ * @param kernel to be used, AUTO or an unsupported kernel selects the best
+ * kernel of the CPU
+ */
+SyncSearch::SyncSearch(const std::string &pattern, Kernel kernel)
+    :len(pattern.length()), kernel(kernel)
+{
+    Kernel best = bestKernel();
+
+    if (this->kernel == AUTO || this->kernel > best) {
+        this->kernel = best;
+    }
+
+    words.assign((len + 63) / 64, 0);
+
+    for (size_t i=0; i < len; i++) {
+        if (pattern[i] == '1') {
+            words[i / 64] |= 1ULL << (63 - i % 64);
+        }
+    }
+
+    // a full anchor byte at each phase needs up to 7 leading bits
+    anchored = len >= 15;
+
+    for (int byte=0; byte < 256; byte++) {
+        phase_mask[byte] = 0;
+    }
+
+    for (int phase=0; phase < 8; phase++) {
+        int offset = (8 - phase) % 8;
+
+        anchor_offset[phase] = offset;
+        anchor[phase][0] = 0;
+        anchor[phase][1] = 0;
+        anchor_pair[phase] = anchored && offset + 16 <= (int) len;
+
+        for (int i=0; anchored && i < 8; i++) {
+            anchor[phase][0] = (anchor[phase][0] << 1) | (pattern[offset + i] == '1');
+
+            if (anchor_pair[phase]) {
+                anchor[phase][1] = (anchor[phase][1] << 1) | (pattern[offset + 8 + i] == '1');
+            }
+        }
+
+        if (anchored) {
+            phase_mask[anchor[phase][0]] |= 1 << phase;
+        }
+    }
+}
+
+/**
+ * @brief SyncSearch::length
+ * @return the number of bits of the pattern
+ */
+size_t
+SyncSearch::length() const
+{
+    return len;
+}
+
+/**
+ * @brief SyncSearch::empty
+ * @return true if there is no pattern to be searched
+ */
+bool
+SyncSearch::empty() const
+{
+    return len == 0;
+}
+
+/**
+ * @brief SyncSearch::getKernel
+ * @return the kernel used by this search
+ */
+SyncSearch::Kernel
+SyncSearch::getKernel() const
+{
+    return kernel;
+}
+
+/**
+ * @brief SyncSearch::bestKernel checks the CPU at runtime
+ * @return the fastest kernel supported by the CPU
+ */
+SyncSearch::Kernel
+SyncSearch::bestKernel()
+{
+#ifdef SYNCSEARCH_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        return SSE2;
+    }
+#endif
+
+    return SCALAR;
+}
+
+/**
+ * @brief SyncSearch::load reads 64 consecutive bits of a packed buffer
+ * @param buf packed bits, most significant bit first
+ * @param nr_bits number of valid bits in buf
+ * @param pos of the first bit to be read
+ * @return the bit at pos as most significant bit followed by the next 63
+ * bits, positions past nr_bits read as 0
+ */
+uint64_t
+SyncSearch::load(const unsigned char *buf, uint64_t nr_bits, uint64_t pos)
+{
+    if (pos >= nr_bits) {
+        return 0;
+    }
+
+    uint64_t nr_bytes = (nr_bits + 7) / 8;
+    uint64_t index = pos / 8;
+    int shift = pos % 8;
+    uint64_t bits = 0;
+
+    for (int i=0; i < 8; i++) {
+        bits = (bits << 8) | (index + i < nr_bytes ? buf[index + i] : 0);
+    }
+
+    if (shift && index + 8 < nr_bytes) {
+        bits = (bits << shift) | (buf[index + 8] >> (8 - shift));
+    }
+    else {
+        bits <<= shift;
+    }
+
+    // hide bits beyond the end of the buffer
+    uint64_t available = nr_bits - pos;
+
+    if (available < 64) {
+        bits &= ~(~0ULL >> available);
+    }
+
+    return bits;
+}
+
+/**
+ * @brief SyncSearch::verify compares the whole pattern, 64 bits at a time
+ * @param buf packed bits, most significant bit first
+ * @param nr_bits number of valid bits in buf
+ * @param pos of the first bit to be compared
+ * @return true if the pattern matches at pos
+ */
+bool
+SyncSearch::verify(const unsigned char *buf, uint64_t nr_bits, uint64_t pos) const
+{
+    if (pos + len > nr_bits) {
+        return false;
+    }
+
+    for (size_t i=0; i < words.size(); i++) {
+        uint64_t diff = load(buf, nr_bits, pos + i * 64) ^ words[i];
+        size_t remaining = len - i * 64;
+
+        // ignore bits behind the end of the pattern
+        if (remaining < 64) {
+            diff &= ~(~0ULL >> remaining);
+        }
+
+        if (diff) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief SyncSearch::candidate verifies an anchor hit and records it
+ * @param index of the byte matching the anchor
+ * @param phase the anchor belongs to
+ * @param from first position a match may start at
+ * @param to position a match has to start before
+ */
+void
+SyncSearch::candidate(const unsigned char *buf, uint64_t nr_bits, size_t index, int phase, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const
+{
+    uint64_t aligned = (uint64_t) index * 8;
+
+    if (aligned < (uint64_t) anchor_offset[phase]) {
+        return;
+    }
+
+    uint64_t pos = aligned - anchor_offset[phase];
+
+    if (pos >= from && pos < to && verify(buf, nr_bits, pos)) {
+        hits.push_back(pos);
+    }
+}
+
+/**
+ * @brief SyncSearch::scanScalar looks up the phases a byte is the first
+ * anchor of, byte by byte
+ * @param first byte to be checked
+ * @param last byte behind the last byte to be checked
+ */
+void
+SyncSearch::scanScalar(const unsigned char *buf, uint64_t nr_bits, size_t first, size_t last, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const
+{
+    size_t nr_bytes = (nr_bits + 7) / 8;
+
+    for (size_t index=first; index < last; index++) {
+        unsigned int phases = phase_mask[buf[index]];
+
+        for (int phase=0; phases; phase++, phases >>= 1) {
+
+            if (!(phases & 1)) {
+                continue;
+            }
+
+            if (anchor_pair[phase] && (index + 1 >= nr_bytes || buf[index + 1] != anchor[phase][1])) {
+                continue;
+            }
+
+            candidate(buf, nr_bits, index, phase, from, to, hits);
+        }
+    }
+}
+
+#ifdef SYNCSEARCH_X86
+
+/**
+ * @brief SyncSearch::scanSSE2 compares anchors 16 bytes at a time, the
+ * remaining bytes are handed to scanScalar()
+ */
+__attribute__((target("sse2")))
+void
+SyncSearch::scanSSE2(const unsigned char *buf, uint64_t nr_bits, size_t first, size_t last, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const
+{
+    size_t nr_bytes = (nr_bits + 7) / 8;
+    __m128i first_anchor[8];
+    __m128i second_anchor[8];
+
+    for (int phase=0; phase < 8; phase++) {
+        first_anchor[phase] = _mm_set1_epi8((char) anchor[phase][0]);
+        second_anchor[phase] = _mm_set1_epi8((char) anchor[phase][1]);
+    }
+
+    size_t index = first;
+
+    // the second anchor is read one byte ahead
+    for (; index + 16 <= last && index + 17 <= nr_bytes; index += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (buf + index));
+        __m128i next = _mm_loadu_si128((const __m128i *) (buf + index + 1));
+
+        for (int phase=0; phase < 8; phase++) {
+            __m128i equal = _mm_cmpeq_epi8(bytes, first_anchor[phase]);
+
+            if (anchor_pair[phase]) {
+                equal = _mm_and_si128(equal, _mm_cmpeq_epi8(next, second_anchor[phase]));
+            }
+
+            unsigned int mask = _mm_movemask_epi8(equal);
+
+            while (mask) {
+                candidate(buf, nr_bits, index + __builtin_ctz(mask), phase, from, to, hits);
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    scanScalar(buf, nr_bits, index, last, from, to, hits);
+}
+
+/**
+ * @brief SyncSearch::scanAVX2 compares anchors 32 bytes at a time, the
+ * remaining bytes are handed to scanScalar()
+ */
+__attribute__((target("avx2")))
+void
+SyncSearch::scanAVX2(const unsigned char *buf, uint64_t nr_bits, size_t first, size_t last, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const
+{
+    size_t nr_bytes = (nr_bits + 7) / 8;
+    __m256i first_anchor[8];
+    __m256i second_anchor[8];
+
+    for (int phase=0; phase < 8; phase++) {
+        first_anchor[phase] = _mm256_set1_epi8((char) anchor[phase][0]);
+        second_anchor[phase] = _mm256_set1_epi8((char) anchor[phase][1]);
+    }
+
+    size_t index = first;
+
+    // the second anchor is read one byte ahead
+    for (; index + 32 <= last && index + 33 <= nr_bytes; index += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *) (buf + index));
+        __m256i next = _mm256_loadu_si256((const __m256i *) (buf + index + 1));
+
+        for (int phase=0; phase < 8; phase++) {
+            __m256i equal = _mm256_cmpeq_epi8(bytes, first_anchor[phase]);
+
+            if (anchor_pair[phase]) {
+                equal = _mm256_and_si256(equal, _mm256_cmpeq_epi8(next, second_anchor[phase]));
+            }
+
+            unsigned int mask = _mm256_movemask_epi8(equal);
+
+            while (mask) {
+                candidate(buf, nr_bits, index + __builtin_ctz(mask), phase, from, to, hits);
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    scanScalar(buf, nr_bits, index, last, from, to, hits);
+}
+
+#else
+
+void
+SyncSearch::scanSSE2(const unsigned char *buf, uint64_t nr_bits, size_t first, size_t last, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const
+{
+    scanScalar(buf, nr_bits, first, last, from, to, hits);
+}
+
+void
+SyncSearch::scanAVX2(const unsigned char *buf, uint64_t nr_bits, size_t first, size_t last, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const
+{
+    scanScalar(buf, nr_bits, first, last, from, to, hits);
+}
+
+#endif
+
+/**
+ * @brief SyncSearch::scanWindow searches patterns shorter than 15 bits
+ * with a sliding window, each byte is checked at all 8 bit phases
+ */
+void
+SyncSearch::scanWindow(const unsigned char *buf, uint64_t nr_bits, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const
+{
+    uint64_t nr_bytes = (nr_bits + 7) / 8;
+    uint64_t mask = (1ULL << len) - 1;
+    uint64_t pattern = words[0] >> (64 - len);
+    uint64_t window = 0;
+
+    for (uint64_t index=from / 8; index < nr_bytes; index++) {
+        window = (window << 8) | buf[index];
+
+        for (int bit=0; bit < 8; bit++) {
+
+            // position of the newest bit in the window
+            uint64_t newest = index * 8 + bit;
+
+            if (newest >= nr_bits) {
+                return;
+            }
+
+            if (newest + 1 < from + len) {
+                continue;
+            }
+
+            uint64_t pos = newest + 1 - len;
+
+            if (pos >= to) {
+                return;
+            }
+
+            if (((window >> (7 - bit)) & mask) == pattern) {
+                hits.push_back(pos);
+            }
+        }
+    }
+}
+
+/**
+ * @brief SyncSearch::findAll finds every occurence of the pattern, also
+ * overlapping ones
+ * @param buf packed bits, most significant bit first
+ * @param nr_bits number of valid bits in buf
+ * @param hits positions of the first bit of each match are appended here
+ * in ascending order
+ * @param from first position a match may start at
+ * @param to position a match has to start before
+ * @return the number of matches appended to hits
+ */
+size_t
+SyncSearch::findAll(const unsigned char *buf, uint64_t nr_bits, std::vector<uint64_t> &hits, uint64_t from, uint64_t to) const
+{
+    size_t before = hits.size();
+
+    if (len == 0 || from >= nr_bits || from >= to) {
+        return 0;
+    }
+
+    if (!anchored) {
+        scanWindow(buf, nr_bits, from, to, hits);
+        return hits.size() - before;
+    }
+
+    // anchors of matches starting in [from, to) are found in these bytes
+    uint64_t nr_bytes = (nr_bits + 7) / 8;
+    uint64_t first = from / 8;
+    uint64_t last = nr_bytes;
+
+    if (to < nr_bits && (to + 6) / 8 + 1 < nr_bytes) {
+        last = (to + 6) / 8 + 1;
+    }
+
+    switch (kernel) {
+        case AVX2:
+            scanAVX2(buf, nr_bits, first, last, from, to, hits);
+            break;
+        case SSE2:
+            scanSSE2(buf, nr_bits, first, last, from, to, hits);
+            break;
+        default:
+            scanScalar(buf, nr_bits, first, last, from, to, hits);
+            break;
+    }
+
+    // phases of one block are reported one after another
+    std::sort(hits.begin() + before, hits.end());
+
+    return hits.size() - before;
+}
+
+/**
+ * @brief SyncSearch::findFirst finds the left most occurence of the
+ * pattern, the buffer is searched in growing chunks so that an early match
+ * does not require a scan of the whole buffer (nor of a whole chunk, e.g.
+ * when stepping through dense matches)
+ * @param buf packed bits, most significant bit first
+ * @param nr_bits number of valid bits in buf
+ * @param from first position a match may start at
+ * @return position of the left most match at or after from or -1
+ */
+int64_t
+SyncSearch::findFirst(const unsigned char *buf, uint64_t nr_bits, uint64_t from) const
+{
+    std::vector<uint64_t> hits;
+    uint64_t chunk = FIND_FIRST_MIN_CHUNK;
+
+    while (from < nr_bits) {
+        uint64_t to = from + chunk;
+
+        if (findAll(buf, nr_bits, hits, from, to)) {
+            return hits[0];
+        }
+
+        from = to;
+        chunk = std::min(2 * chunk, FIND_FIRST_CHUNK);
+    }
+
+    return -1;
+}
@@ -0,0 +1,68 @@
+#ifndef SYNCSEARCH_H
+#define SYNCSEARCH_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The SyncSearch class finds all occurences of a pattern in a large
+ * packed bit buffer (8 bits per byte, most significant bit first) at any
+ * of the 8 bit phases. For each phase the pattern is reduced to one or two
+ * byte aligned anchor bytes which are searched 16 (SSE2) or 32 (AVX2)
+ * bytes at a time, candidates are verified 64 bits at a time. The kernel
+ * is selected at runtime, a scalar kernel is used on other CPUs.
+ */
+class SyncSearch
+{
+    public:
+        enum Kernel {
+            AUTO,
+            SCALAR,
+            SSE2,
+            AVX2
+        };
+
+    private:
+        size_t len;
+        Kernel kernel;
+
+        // pattern left aligned (first bit is the most significant bit)
+        std::vector<uint64_t> words;
+
+        // per bit phase: offset of the first byte aligned pattern bit,
+        // anchor bytes and whether the second anchor byte is valid
+        int anchor_offset[8];
+        unsigned char anchor[8][2];
+        bool anchor_pair[8];
+
+        // bit n is set if byte is the first anchor of phase n
+        unsigned char phase_mask[256];
+
+        // patterns too short to have an anchor byte at every phase are
+        // searched with a sliding window instead
+        bool anchored;
+
+        void candidate(const unsigned char *buf, uint64_t nr_bits, size_t index, int phase, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const;
+        bool verify(const unsigned char *buf, uint64_t nr_bits, uint64_t pos) const;
+        void scanScalar(const unsigned char *buf, uint64_t nr_bits, size_t first, size_t last, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const;
+        void scanSSE2(const unsigned char *buf, uint64_t nr_bits, size_t first, size_t last, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const;
+        void scanAVX2(const unsigned char *buf, uint64_t nr_bits, size_t first, size_t last, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const;
+        void scanWindow(const unsigned char *buf, uint64_t nr_bits, uint64_t from, uint64_t to, std::vector<uint64_t> &hits) const;
+
+    public:
+        SyncSearch(const std::string &pattern = "", Kernel kernel = AUTO);
+
+        size_t length() const;
+        bool empty() const;
+        Kernel getKernel() const;
+
+        static Kernel bestKernel();
+        static uint64_t load(const unsigned char *buf, uint64_t nr_bits, uint64_t pos);
+
+        size_t findAll(const unsigned char *buf, uint64_t nr_bits, std::vector<uint64_t> &hits, uint64_t from = 0, uint64_t to = (uint64_t) -1) const;
+        int64_t findFirst(const unsigned char *buf, uint64_t nr_bits, uint64_t from = 0) const;
+};
+
+#endif // SYNCSEARCH_H
@@ -22,8 +22,12 @@
 #include "config.h"
 #endif
 
+#include <algorithm>
+#include <iostream>
 #include <string>
+#include <vector>
 #include <gnuradio/io_signature.h>
+#include <gnuradio/tags.h>
 #include "vizsink_b_impl.h"
 #include "binimg.h"
 
@@ -31,22 +35,97 @@
 namespace gr {
   namespace binviz {
 
+    /*
+     * Failover to packed bytes on unknown input formats
+     */
+    static BitPacker::Format
+    inputFormat(int input_format)
+    {
+      switch (input_format) {
+        case 0:
+          return BitPacker::PACKED_MSB;
+        case 1:
+          return BitPacker::PACKED_LSB;
+        case 2:
+          return BitPacker::UNPACKED;
+      }
+
+      std::cerr << "BinViz: unknown input format " << input_format << ", packed bytes assumed" << std::endl;
+
+      return BitPacker::PACKED_MSB;
+    }
+
+    /*
+     * Failover to blocking on unknown overflow policies
+     */
+    static HandoffRing::Overflow
+    overflowPolicy(int overflow)
+    {
+      switch (overflow) {
+        case 0:
+          return HandoffRing::BLOCK;
+        case 1:
+          return HandoffRing::DROP_OLDEST;
+        case 2:
+          return HandoffRing::DECIMATE;
+      }
+
+      std::cerr << "BinViz: unknown overflow policy " << overflow << ", blocking assumed" << std::endl;
+
+      return HandoffRing::BLOCK;
+    }
+
+    /*
+     * The image settings of the block parameters (GRC passes them one by
+     * one, in the order of make())
+     */
+    static BinImg::Options
+    imageOptions(const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern, bool skip_zero_bytes, double frame_rate, bool headless, const std::string &dump_file, const std::string &snapshot_file, const std::string &stream_file, double export_interval, const std::string &scrollback_file, const std::string &index_file, bool column_stats, bool dedup, int start_errors, int end_errors, const std::string &start_tag_key, const std::string &end_tag_key, int input_format, int handoff_size, int overflow)
+    {
+      BinImg::Options options;
+
+      options.start_pattern = start_pattern;
+      options.end_pattern = end_pattern;
+      options.drop_pattern = drop_pattern;
+      options.skip_zero_bytes = skip_zero_bytes;
+      options.frame_rate = frame_rate;
+      options.headless = headless;
+      options.dump_file = dump_file;
+      options.snapshot_file = snapshot_file;
+      options.stream_file = stream_file;
+      options.export_interval = export_interval;
+      options.scrollback_file = scrollback_file;
+      options.index_file = index_file;
+      options.column_stats = column_stats;
+      options.dedup = dedup;
+      options.start_errors = start_errors;
+      options.end_errors = end_errors;
+      options.start_marks = !start_tag_key.empty();
+      options.end_marks = !end_tag_key.empty();
+      options.input_format = inputFormat(input_format);
+      options.handoff_bits = handoff_size > 0 ? handoff_size : 0;
+      options.overflow = overflowPolicy(overflow);
+
+      return options;
+    }
+
     vizsink_b::sptr
-    vizsink_b::make(int width, int height, const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern, bool skip_zero_bytes)
+    vizsink_b::make(int width, int height, const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern, bool skip_zero_bytes, double frame_rate, bool headless, const std::string &dump_file, const std::string &snapshot_file, const std::string &stream_file, double export_interval, const std::string &scrollback_file, const std::string &index_file, bool column_stats, bool dedup, int start_errors, int end_errors, const std::string &start_tag_key, const std::string &end_tag_key, int input_format, int handoff_size, int overflow)
     {
       return gnuradio::get_initial_sptr
-        (new vizsink_b_impl(width, height, start_pattern, end_pattern, drop_pattern, skip_zero_bytes));
+        (new vizsink_b_impl(width, height, start_pattern, end_pattern, drop_pattern, skip_zero_bytes, frame_rate, headless, dump_file, snapshot_file, stream_file, export_interval, scrollback_file, index_file, column_stats, dedup, start_errors, end_errors, start_tag_key, end_tag_key, input_format, handoff_size, overflow));
     }
 
     /*
      * The private constructor
      */
-    vizsink_b_impl::vizsink_b_impl(int width, int height, const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern, bool skip_zero_bytes)
+    vizsink_b_impl::vizsink_b_impl(int width, int height, const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern, bool skip_zero_bytes, double frame_rate, bool headless, const std::string &dump_file, const std::string &snapshot_file, const std::string &stream_file, double export_interval, const std::string &scrollback_file, const std::string &index_file, bool column_stats, bool dedup, int start_errors, int end_errors, const std::string &start_tag_key, const std::string &end_tag_key, int input_format, int handoff_size, int overflow)
       : gr::sync_block("vizsink_b",
               gr::io_signature::make(1, 1, sizeof(unsigned char)),
               gr::io_signature::make(0, 0, 0)),
-              img(width, height, start_pattern, end_pattern, drop_pattern),
-              skip_zero_bytes(skip_zero_bytes)
+              img(width, height, imageOptions(start_pattern, end_pattern, drop_pattern, skip_zero_bytes, frame_rate, headless, dump_file, snapshot_file, stream_file, export_interval, scrollback_file, index_file, column_stats, dedup, start_errors, end_errors, start_tag_key, end_tag_key, input_format, handoff_size, overflow)),
+              start_tags(!start_tag_key.empty()), end_tags(!end_tag_key.empty()),
+              start_key(pmt::intern(start_tag_key)), end_key(pmt::intern(end_tag_key))
     {
         // what else?
     }
@@ -58,36 +137,115 @@ namespace gr {
     {
     }
 
+    uint64_t
+    vizsink_b_impl::nr_packets()
+    {
+        return img.packets();
+    }
+
+    std::vector<unsigned char>
+    vizsink_b_impl::packet(uint64_t nr)
+    {
+        std::vector<unsigned char> packed;
+        std::vector<unsigned char> bits;
+        int64_t nr_bits = img.fetchPacket(nr, packed);
+
+        // unpack, one bit per byte like the stream fed to the block
+        for (int64_t i=0; i < nr_bits; i++) {
+            bits.push_back((packed[i / 8] >> (7 - i % 8)) & 1);
+        }
+
+        return bits;
+    }
+
+    void
+    vizsink_b_impl::show_packet(uint64_t nr)
+    {
+        img.showPacket(nr);
+    }
+
+    std::vector<float>
+    vizsink_b_impl::column_frequency()
+    {
+        std::vector<double> frequency;
+        std::vector<double> entropy;
+
+        img.fetchColumnStats(frequency, entropy);
+
+        return std::vector<float>(frequency.begin(), frequency.end());
+    }
+
+    std::vector<float>
+    vizsink_b_impl::column_entropy()
+    {
+        std::vector<double> frequency;
+        std::vector<double> entropy;
+
+        img.fetchColumnStats(frequency, entropy);
+
+        return std::vector<float>(entropy.begin(), entropy.end());
+    }
+
     int
     vizsink_b_impl::work(int noutput_items,
         gr_vector_const_void_star &input_items,
         gr_vector_void_star &output_items)
     {
-        int consumed = 0;
-
-        // loop over vector of input items
-        for (consumed; consumed < input_items.size(); consumed++) {
-
-          // get input item
-          const unsigned char *in = (const unsigned char *) input_items[consumed];
-
-          if (skip_zero_bytes) {
-              if (*in != 0) {
-                  // process data only if byte was not 0
-                  img.consume(*in);
-              }
-          }
-          else {
-              // process data in any case
-              img.consume(*in);
-          }
-
-          // on debug wait for user input (mouse move, key hits
-          // img.wait();
+        const unsigned char *in = (const unsigned char *) input_items[0];
+
+        // hand the whole window to the image in one go, zero bytes are
+        // filtered by the image itself
+        if (!start_tags && !end_tags) {
+            img.consume(in, noutput_items);
+
+            return noutput_items;
+        }
+
+        // framed by tags, the window is consumed in pieces between them
+        uint64_t first = nitems_read(0);
+        std::vector<gr::tag_t> starts;
+        std::vector<gr::tag_t> ends;
+
+        if (start_tags) {
+            get_tags_in_range(starts, 0, first, first + noutput_items, start_key);
+            std::sort(starts.begin(), starts.end(), gr::tag_t::offset_compare);
+        }
+
+        if (end_tags) {
+            get_tags_in_range(ends, 0, first, first + noutput_items, end_key);
+            std::sort(ends.begin(), ends.end(), gr::tag_t::offset_compare);
+        }
+
+        size_t done = 0;
+        size_t i = 0;
+        size_t j = 0;
+
+        while (i < starts.size() || j < ends.size()) {
+
+            // a line ends before the next one starts on the same byte
+            bool is_end = j < ends.size() && (i == starts.size() || ends[j].offset <= starts[i].offset);
+            size_t pos = (is_end ? ends[j++].offset : starts[i++].offset) - first;
+
+            if (pos > done) {
+                img.consume(in + done, pos - done);
+                done = pos;
+            }
+
+            if (is_end) {
+                img.markEnd();
+            }
+            else {
+                img.markStart();
+            }
         }
 
+        img.consume(in + done, noutput_items - done);
+
+        // on debug wait for user input (mouse move, key hits
+        // img.wait();
+
         // Tell runtime system how many output items we produced.
-        return consumed;
+        return noutput_items;
     }
 
   } /* namespace binviz */
@@ -22,7 +22,9 @@
 #define INCLUDED_BINVIZ_VIZSINK_S_IMPL_H
 
 #include <string>
+#include <vector>
 #include <binviz/vizsink_b.h>
+#include <pmt/pmt.h>
 #include "binimg.h"
 
 namespace gr {
@@ -32,12 +34,23 @@ namespace gr {
     {
      private:
         BinImg img;
-        bool skip_zero_bytes;
+
+        // lines are framed by the stream tags with these keys if set
+        bool start_tags;
+        bool end_tags;
+        pmt::pmt_t start_key;
+        pmt::pmt_t end_key;
 
      public:
-      vizsink_b_impl(int width, int height, const std::string &start_pattern = "", const std::string &end_pattern = "", const std::string &drop_pattern = "", bool skip_zero_bytes = false);
+      vizsink_b_impl(int width, int height, const std::string &start_pattern = "", const std::string &end_pattern = "", const std::string &drop_pattern = "", bool skip_zero_bytes = false, double frame_rate = 30, bool headless = false, const std::string &dump_file = "", const std::string &snapshot_file = "", const std::string &stream_file = "", double export_interval = 0, const std::string &scrollback_file = "", const std::string &index_file = "", bool column_stats = false, bool dedup = false, int start_errors = 0, int end_errors = 0, const std::string &start_tag_key = "", const std::string &end_tag_key = "", int input_format = 0, int handoff_size = 0, int overflow = 0);
       ~vizsink_b_impl();
 
+      uint64_t nr_packets();
+      std::vector<unsigned char> packet(uint64_t nr);
+      void show_packet(uint64_t nr);
+      std::vector<float> column_frequency();
+      std::vector<float> column_entropy();
+
       // Where all the action really happens
       int work(int noutput_items,
          gr_vector_const_void_star &input_items,
@@ -0,0 +1,94 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2016 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+#include <gnuradio/io_signature.h>
+#include "vizsink_multi_b_impl.h"
+
+
+namespace gr {
+  namespace binviz {
+
+    /*
+     * The image shows lines framed by the MultiFramer, it frames nothing
+     * itself
+     */
+    static BinImg::Options
+    imageOptions(double frame_rate, bool headless)
+    {
+      BinImg::Options options;
+
+      options.frame_rate = frame_rate;
+      options.headless = headless;
+
+      return options;
+    }
+
+    vizsink_multi_b::sptr
+    vizsink_multi_b::make(int num_inputs, int width, int height, const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern, bool skip_zero_bytes, int view, int nr_threads, double frame_rate, bool headless)
+    {
+      return gnuradio::get_initial_sptr
+        (new vizsink_multi_b_impl(num_inputs, width, height, start_pattern, end_pattern, drop_pattern, skip_zero_bytes, view, nr_threads, frame_rate, headless));
+    }
+
+    /*
+     * The private constructor
+     */
+    vizsink_multi_b_impl::vizsink_multi_b_impl(int num_inputs, int width, int height, const std::string &start_pattern, const std::string &end_pattern, const std::string &drop_pattern, bool skip_zero_bytes, int view, int nr_threads, double frame_rate, bool headless)
+      : gr::sync_block("vizsink_multi_b",
+              gr::io_signature::make(num_inputs, num_inputs, sizeof(unsigned char)),
+              gr::io_signature::make(0, 0, 0)),
+              img(width, height, imageOptions(frame_rate, headless)),
+              framer(img, num_inputs, width, height, start_pattern, end_pattern, drop_pattern, skip_zero_bytes, view ? MultiFramer::DIFF : MultiFramer::INTERLEAVE, nr_threads),
+              in(num_inputs)
+    {
+    }
+
+    /*
+     * Our virtual destructor.
+     */
+    vizsink_multi_b_impl::~vizsink_multi_b_impl()
+    {
+    }
+
+    int
+    vizsink_multi_b_impl::work(int noutput_items,
+        gr_vector_const_void_star &input_items,
+        gr_vector_void_star &output_items)
+    {
+        for (size_t i=0; i < in.size(); i++) {
+            in[i] = (const unsigned char *) input_items[i];
+        }
+
+        // the streams are framed independently and aligned line by line
+        framer.consume(in, noutput_items);
+
+        // Tell runtime system how many output items we produced.
+        return noutput_items;
+    }
+
+  } /* namespace binviz */
+} /* namespace gr */
+
@@ -0,0 +1,55 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2016 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_BINVIZ_VIZSINK_MULTI_B_IMPL_H
+#define INCLUDED_BINVIZ_VIZSINK_MULTI_B_IMPL_H
+
+#include <string>
+#include <vector>
+#include <binviz/vizsink_multi_b.h>
+#include "binimg.h"
+#include "multiframer.h"
+
+namespace gr {
+  namespace binviz {
+
+    class vizsink_multi_b_impl : public vizsink_multi_b
+    {
+     private:
+        BinImg img;
+        MultiFramer framer;
+
+        std::vector<const unsigned char *> in;
+
+     public:
+      vizsink_multi_b_impl(int num_inputs, int width, int height, const std::string &start_pattern = "", const std::string &end_pattern = "", const std::string &drop_pattern = "", bool skip_zero_bytes = false, int view = 0, int nr_threads = 1, double frame_rate = 30, bool headless = false);
+      ~vizsink_multi_b_impl();
+
+      // Where all the action really happens
+      int work(int noutput_items,
+         gr_vector_const_void_star &input_items,
+         gr_vector_void_star &output_items);
+    };
+
+  } // namespace binviz
+} // namespace gr
+
+#endif /* INCLUDED_BINVIZ_VIZSINK_MULTI_B_IMPL_H */
+
@@ -22,6 +22,16 @@
 from gnuradio import gr, gr_unittest
 from gnuradio import blocks
 import binviz_swig as binviz
+import os
+import tempfile
+import pmt
+
+def make_tag (key, offset):
+    tag = gr.tag_t()
+    tag.key = pmt.intern(key)
+    tag.value = pmt.PMT_T
+    tag.offset = offset
+    return tag
 
 class qa_vizsink_b (gr_unittest.TestCase):
 
@@ -38,13 +48,33 @@ class qa_vizsink_b (gr_unittest.TestCase):
 
         # setup blocks
         src = blocks.vector_source_b(src_data)
-        dst = binviz.vizsink_b(100,100,"","","", True)
+        dst = binviz.vizsink_b(100,100,"","","", True, 30, True)
+        self.tb.connect(src, dst)
+
+        # run the stuff
+        self.tb.run ()
+
+        # check data => visually (set headless to False to see it)
+
+    def test_002_tags (self):
+
+        # two packets framed by tags, the byte in between is dropped
+        src_data = (0b11110000, 0b10101010, 0b00000001, 0b11001100, 0b00110011, 0b00000001)
+        tags = (make_tag("sob", 0), make_tag("eob", 2), make_tag("sob", 3), make_tag("eob", 5))
+        fd, index_file = tempfile.mkstemp()
+        os.close(fd)
+        self.addCleanup(os.unlink, index_file)
+
+        # setup blocks
+        src = blocks.vector_source_b(src_data, False, 1, tags)
+        dst = binviz.vizsink_b(100,100,"","","", False, 30, True, "", "", "", 0, "", index_file, False, False, 0, 0, "sob", "eob")
         self.tb.connect(src, dst)
 
         # run the stuff
         self.tb.run ()
 
-        # check data => visually
+        # the start tag of the second packet sits on its first byte
+        self.assertEqual(dst.nr_packets(), 2)
 
 
 if __name__ == '__main__':
@@ -0,0 +1,55 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+# 
+# Copyright 2016 <+YOU OR YOUR COMPANY+>.
+# 
+# This is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3, or (at your option)
+# any later version.
+# 
+# This software is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this software; see the file COPYING.  If not, write to
+# the Free Software Foundation, Inc., 51 Franklin Street,
+# Boston, MA 02110-1301, USA.
+# 
+
+from gnuradio import gr, gr_unittest
+from gnuradio import blocks
+import binviz_swig as binviz
+
+class qa_vizsink_multi_b (gr_unittest.TestCase):
+
+    def setUp (self):
+        self.tb = gr.top_block ()
+
+    def tearDown (self):
+        self.tb = None
+
+    def test_001_t (self):
+
+        # setup source data vectors (packed bytes, MSB first), the start
+        # pattern 1111 is at bit 4 of stream 0 and at bit 0 of stream 1
+        src_data_0 = (0x0F, 0x55, 0x0F, 0x55, 0x0F, 0x55)
+        src_data_1 = (0xF0, 0x55, 0xF0, 0x55, 0xF0, 0x55)
+
+        # setup blocks
+        src_0 = blocks.vector_source_b(src_data_0)
+        src_1 = blocks.vector_source_b(src_data_1)
+        dst = binviz.vizsink_multi_b(2, 100, 100, "1111", "", "", False, 1, 2, 30, True)
+        self.tb.connect(src_0, (dst, 0))
+        self.tb.connect(src_1, (dst, 1))
+
+        # run the stuff
+        self.tb.run ()
+
+        # check data => visually (set headless to False to see it)
+
+
+if __name__ == '__main__':
+    gr_unittest.run(qa_vizsink_multi_b, "qa_vizsink_multi_b.xml")
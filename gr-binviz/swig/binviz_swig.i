@@ -9,8 +9,11 @@
 
 %{
 #include "binviz/vizsink_b.h"
+#include "binviz/vizsink_multi_b.h"
 %}
 
 
 %include "binviz/vizsink_b.h"
 GR_SWIG_BLOCK_MAGIC2(binviz, vizsink_b);
+%include "binviz/vizsink_multi_b.h"
+GR_SWIG_BLOCK_MAGIC2(binviz, vizsink_multi_b);